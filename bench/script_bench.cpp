@@ -0,0 +1,149 @@
+// Script load and run benchmark.
+//
+//   script_bench <script>...
+//
+// For each script it times the cold-load stages the server goes through on
+// a cache miss (tokenize, parse, optimize, resolve + compile). Tokenizing is
+// also timed with the old std::string lexer in baseline_lexer.hpp; "lex
+// gain" is old over new. Then it runs the bytecode for an empty GET twice:
+// once compiled from the tree as parsed and once from the optimized tree,
+// and "opt gain" is raw over optimized. Each figure is the mean over as
+// many repetitions as fit in MIN_SECONDS.
+//
+// Templates are loaded relative to the directory holding service/, so a
+// script at <dir>/service/x.script runs with <dir> as working directory.
+#include "baseline_lexer.hpp"
+#include "script_lexer.hpp"
+#include "script_parser.hpp"
+#include "script_optimizer.hpp"
+#include "script_resolver.hpp"
+#include "script_vm.hpp"
+#include "logic_engine.hpp"
+#include "logger.hpp"
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+
+static constexpr double MIN_SECONDS = 0.2;
+
+// Mean seconds per call of fn, repeated until MIN_SECONDS have passed
+template <typename Fn>
+static double time_per_call(Fn&& fn) {
+    using Clock = std::chrono::steady_clock;
+    size_t calls = 0;
+    auto start = Clock::now();
+    double elapsed = 0;
+    do {
+        fn();
+        calls++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < MIN_SECONDS);
+    return elapsed / calls;
+}
+
+struct Program {
+    std::unique_ptr<ASTNode> ast;
+    std::vector<std::string> locals;
+    Bytecode code;
+};
+
+// What the script cache builds, with or without the optimizer pass
+static Program load(const std::string& source, bool optimize) {
+    Program p;
+    ScriptLexer lexer(source);
+    ScriptParser parser(lexer.tokenize());
+    p.ast = parser.parseProgram();
+    if (optimize) ScriptOptimizer::optimize(p.ast);
+    p.locals = ScriptResolver::resolve(*p.ast);
+    p.code = ScriptCompiler::compile(*p.ast);
+    return p;
+}
+
+static void run(const Program& p) {
+    HttpRequest req;
+    req.method = "GET";
+    req.path = "/";
+    req.version = "HTTP/1.1";
+    HttpResponse res;
+    ScriptContext ctx(req, res);
+    ctx.locals.resize(p.locals.size());
+    ctx.localNames = &p.locals;
+    ScriptVM::run(p.code, ctx);
+}
+
+static bool read_file(const std::string& path, std::string& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char buf[16 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static double us(double seconds) { return seconds * 1e6; }
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <script>...\n", argv[0]);
+        return 2;
+    }
+    Logger::setLevel(LogLevel::ERR);
+
+    char home[4096];
+    if (!getcwd(home, sizeof(home))) return 1;
+
+    printf("%-16s %7s | %9s %9s %8s | %9s %9s %9s | %7s %7s | %11s %11s %8s\n", "script", "bytes", "lex (old)",
+           "tokenize", "lex gain", "parse", "optimize", "compile", "nodes", "after", "run (raw)", "run (opt)",
+           "opt gain");
+    printf("%-16s %7s | %9s %9s %8s | %9s %9s %9s | %7s %7s | %11s %11s %8s\n", "", "", "us", "us", "", "us", "us",
+           "us", "", "", "us", "us", "");
+
+    for (int i = 1; i < argc; i++) {
+        std::string path = argv[i];
+        std::string source;
+        if (!read_file(path, source)) {
+            fprintf(stderr, "script_bench: can't read %s\n", path.c_str());
+            return 1;
+        }
+        size_t cut = path.rfind("/service/");
+        if (chdir(cut == std::string::npos ? home : path.substr(0, cut).c_str()) != 0) return 1;
+        std::string name = path.substr(path.rfind('/') + 1);
+
+        try {
+            // Cold load. Parsing and optimizing consume their input, so
+            // each stage is timed as the pipeline up to it minus the
+            // pipeline before it.
+            double baseline = time_per_call([&] { baseline::ScriptLexer(source).tokenize(); });
+            double tokenize = time_per_call([&] { ScriptLexer(source).tokenize(); });
+            double parsed = time_per_call([&] { ScriptParser(ScriptLexer(source).tokenize()).parseProgram(); });
+            double optimized = time_per_call([&] {
+                auto ast = ScriptParser(ScriptLexer(source).tokenize()).parseProgram();
+                ScriptOptimizer::optimize(ast);
+            });
+
+            Program raw = load(source, false);
+            Program opt = load(source, true);
+            double compile = time_per_call([&] {
+                ScriptResolver::resolve(*opt.ast);
+                ScriptCompiler::compile(*opt.ast);
+            });
+            double parse = parsed - tokenize;
+            double optimize = optimized - parsed;
+
+            double runRaw = time_per_call([&] { run(raw); });
+            double runOpt = time_per_call([&] { run(opt); });
+
+            printf("%-16s %7zu | %9.1f %9.1f %7.2fx | %9.1f %9.1f %9.1f | %7zu %7zu | %11.1f %11.1f %7.2fx\n",
+                   name.c_str(), source.size(), us(baseline), us(tokenize), baseline / tokenize, us(parse),
+                   us(optimize), us(compile), raw.ast->nodeCount(), opt.ast->nodeCount(), us(runRaw), us(runOpt),
+                   runRaw / runOpt);
+        } catch (const std::exception& e) {
+            printf("%-16s %7zu | failed: %s\n", name.c_str(), source.size(), e.what());
+        }
+        fflush(stdout);
+    }
+
+    Logger::flush();
+    return 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed-capacity multi-producer / multi-consumer FIFO.
+// Producers never block: tryPush() fails when the queue is full so the
+// caller can shed load. Consumers sleep in pop() until work arrives.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : slots(capacity) {}
+
+    bool tryPush(T&& item) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (closed || count == slots.size()) return false;
+            slots[(head + count) % slots.size()] = std::move(item);
+            count++;
+        }
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available. Returns false once the queue has
+    // been closed and drained.
+    bool pop(T& out) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait(lock, [this] { return count > 0 || closed; });
+        if (count == 0) return false;
+        out = std::move(slots[head]);
+        head = (head + 1) % slots.size();
+        count--;
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        not_empty.notify_all();
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+private:
+    std::vector<T> slots;
+    size_t head = 0;
+    size_t count = 0;
+    bool closed = false;
+    std::mutex mtx;
+    std::condition_variable not_empty;
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Background thread that reloads the route table when asked to: on SIGHUP,
+// or when service/routes.conf is rewritten (inotify on the directory, so
+// editors that save by renaming are caught too). Being the one thread
+// that takes signals, it also reports the fragment cache counters and
+// dumps the script profile (when on) on SIGUSR1.
+class ConfigWatcher {
+public:
+    // Blocks SIGHUP and SIGUSR1 in the calling thread, so call it before any other
+    // thread is started: they inherit the mask and only the watcher ever
+    // sees the signal.
+    static void start(const std::string& dir = "service", const std::string& file = "routes.conf");
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include "event_loop.hpp"
+
+// Default backend: edge-triggered epoll with plain read()/writev()/sendfile()
+// on non-blocking sockets. Works on any Linux kernel.
+class EpollLoop : public EventLoop {
+public:
+    EpollLoop(int listen_fd, WorkerPool& pool, const ServerConfig& cfg);
+    ~EpollLoop() override;
+
+    void run() override;
+
+protected:
+    void startWrite(Connection& conn) override { onWritable(conn); }
+    IoStatus readPending(Connection& conn) override { return read_full_request(conn); }
+    void abandonSocket(Connection& conn) override;
+    void closeSocket(std::unique_ptr<Connection> conn) override;
+
+private:
+    void acceptConnections();
+    void onReadable(Connection& conn);
+    void onWritable(Connection& conn);
+
+    int epoll_fd = -1;
+};
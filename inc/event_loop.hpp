@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "http.hpp"
+#include "timer_wheel.hpp"
+
+class WorkerPool;
+
+// How a worker's response reaches the client
+enum class Delivery {
+    BUFFERED,       // the loop writes it
+    STREAMED,       // the worker already sent it, chunk by chunk
+    STREAM_FAILED   // the worker gave up half way; the connection is unusable
+};
+
+// Single-threaded reactor that owns the listening socket and every client
+// socket; requests are handed to the worker pool only once they have fully
+// arrived. This class is the request/response state machine shared by all
+// I/O backends. The backends (epoll_loop.hpp, uring_loop.hpp) only move
+// bytes and tell it what happened.
+class EventLoop {
+public:
+    virtual ~EventLoop();
+
+    // Build the loop asked for in cfg.backend, falling back to epoll when
+    // the kernel can't do io_uring the way we need it.
+    static std::unique_ptr<EventLoop> create(int listen_fd, WorkerPool& pool, const ServerConfig& cfg);
+
+    virtual void run() = 0;
+
+    // Called from worker threads: hand a finished response back to the
+    // connection and wake the loop up.
+    void complete(int fd, uint64_t conn_id, HttpResponse&& response,
+                  Delivery delivery = Delivery::BUFFERED);
+
+    const ServerConfig& config() const { return cfg; }
+
+protected:
+    EventLoop(int listen_fd, WorkerPool& pool, const ServerConfig& cfg);
+
+    // --- Backend hooks ---
+    // Send conn's queued response (conn.state is WRITING); call
+    // finishResponse() once it's all out.
+    virtual void startWrite(Connection& conn) = 0;
+    // Pick up input that arrived (or was left in the kernel) while we were
+    // busy with the previous request. Only called when conn.read_pending.
+    virtual IoStatus readPending(Connection& conn) = 0;
+    // Hang up on a client whose request a worker still holds. The fd must
+    // stay open until closeSocket() is called for it.
+    virtual void abandonSocket(Connection& conn) = 0;
+    // Close the socket and recycle the connection (now or once the kernel
+    // is done with its buffers).
+    virtual void closeSocket(std::unique_ptr<Connection> conn) = 0;
+
+    // --- Shared state machine ---
+    Connection& addConnection(int fd);
+    Connection* findConnection(uint64_t conn_id);
+    void onRequestStatus(Connection& conn, IoStatus status);
+    void dispatch(Connection& conn);
+    void drainCompletions();
+    void finishResponse(Connection& conn);
+    void closeConnection(Connection& conn);
+    void armTimer(Connection& conn, Timeout kind);
+    void expireTimers();
+    void recycle(std::unique_ptr<Connection> conn);
+
+    int listen_fd;
+    int wake_fd = -1;           // eventfd poked by workers
+    WorkerPool& pool;
+    ServerConfig cfg;
+    TimerWheel timers;
+
+    // Live connections by conn id (never 0). Ids aren't reused, so a late
+    // event or completion can't land on a newer socket with the same fd.
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections;
+
+private:
+    void onTimeout(Connection& conn);
+
+    struct Completion {
+        int fd;
+        uint64_t conn_id;
+        HttpResponse response;
+        Delivery delivery;
+    };
+
+    uint64_t next_conn_id = 1;
+
+    std::mutex completions_mutex;
+    std::vector<Completion> completions;
+
+    // Closed connections kept for reuse. Each loop has its own, so the
+    // allocator is never contended across shards.
+    std::vector<std::unique_ptr<Connection>> spare_connections;
+
+    // Closed by the client while a worker was still on them, by conn id
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> orphaned;
+};
@@ -0,0 +1,138 @@
+#pragma once
+#include "logger.hpp"
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// LRU of things built from a file on disk (parsed scripts, templates...),
+// keyed by path. Values are immutable and shared, so any number of threads
+// can use one while a newer version replaces it in the cache.
+//
+// Like StaticFileCache, entries are re-stat()ed at most once per second and
+// rebuilt when the inode, size or mtime changed; a warm hit does no I/O.
+template <typename T>
+class FileCache {
+public:
+    // Builds the value from the file's contents. May throw: the exception
+    // is cached in place of the value and rethrown by every get() until
+    // the file changes, so a broken file is built once per change.
+    using Loader = std::function<std::shared_ptr<const T>(const std::string& path, const std::string& source)>;
+
+    explicit FileCache(Loader loader, size_t capacity = 256)
+        : loader(std::move(loader)), capacity(capacity) {}
+
+    // nullptr if the file can't be read; throws what the loader threw
+    std::shared_ptr<const T> get(const std::string& path) {
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = index.find(path);
+            if (it != index.end()) {
+                Entry& entry = *it->second;
+                lru.splice(lru.begin(), lru, it->second);
+                if (now - entry.checked < std::chrono::seconds(1)) return unwrap(entry);
+
+                struct stat st;
+                if (stat(path.c_str(), &st) == 0 && sameFile(entry, st)) {
+                    entry.checked = now;
+                    return unwrap(entry);
+                }
+                lru.erase(it->second);
+                index.erase(it);
+            }
+        }
+
+        // Read and build outside the lock; two threads missing together
+        // both build, and the last one in wins.
+        Entry entry;
+        std::string source;
+        if (!readFile(path, source, entry)) return nullptr;
+        entry.path = path;
+        try {
+            entry.value = loader(path, source);
+            LOG(LogLevel::DEBUG, "File cache: built " + path);
+        } catch (...) {
+            entry.error = std::current_exception();
+            LOG(LogLevel::DEBUG, "File cache: " + path + " failed to build");
+        }
+        entry.checked = now;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(path);
+        if (it != index.end()) {
+            lru.erase(it->second);
+            index.erase(it);
+        }
+        lru.push_front(entry);
+        index[path] = lru.begin();
+        if (lru.size() > capacity) {
+            index.erase(lru.back().path);
+            lru.pop_back();
+        }
+        return unwrap(entry);
+    }
+
+private:
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const T> value;
+        std::exception_ptr error;   // set instead of value if the loader threw
+        ino_t inode = 0;
+        off_t size = 0;
+        timespec mtime{};
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    static std::shared_ptr<const T> unwrap(const Entry& entry) {
+        if (entry.error) std::rethrow_exception(entry.error);
+        return entry.value;
+    }
+
+    static bool sameFile(const Entry& entry, const struct stat& st) {
+        return st.st_ino == entry.inode && st.st_size == entry.size &&
+               st.st_mtim.tv_sec == entry.mtime.tv_sec && st.st_mtim.tv_nsec == entry.mtime.tv_nsec;
+    }
+
+    // The stat() data comes from the same fd we read, so it describes
+    // exactly the bytes we built from
+    static bool readFile(const std::string& path, std::string& out, Entry& entry) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            return false;
+        }
+        entry.inode = st.st_ino;
+        entry.size = st.st_size;
+        entry.mtime = st.st_mtim;
+
+        out.resize(st.st_size);
+        size_t done = 0;
+        while (done < out.size()) {
+            ssize_t n = read(fd, &out[done], out.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += n;
+        }
+        out.resize(done);
+        close(fd);
+        return true;
+    }
+
+    Loader loader;
+    size_t capacity;
+    std::list<Entry> lru;    // front = most recently used
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index;
+    std::mutex mtx;
+};
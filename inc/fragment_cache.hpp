@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Rendered output of {% cache %} blocks, shared by every template and
+// thread. Keys go to one of SHARDS independent LRUs, each with its own
+// lock and an equal part of the byte budget, so concurrent renders rarely
+// wait on each other. Entries also expire after the block's TTL.
+class FragmentCache {
+public:
+    static constexpr size_t SHARDS = 16;
+    // Longest TTL in seconds; put() shortens longer ones to this
+    static constexpr int MAX_TTL = 7 * 24 * 60 * 60;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;     // absent or expired
+        uint64_t evictions = 0;  // pushed out to stay under the budget
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    // Total budget for keys + fragments (--fragment-cache-mb)
+    static void setCapacity(size_t bytes);
+
+    // nullptr on a miss
+    static std::shared_ptr<const std::string> get(const std::string& key);
+    static void put(const std::string& key, std::string html, std::chrono::seconds ttl);
+
+    static Stats stats();
+    // One line for the log
+    static std::string describe();
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sys/types.h>
+#include "router.hpp"
+#include "http_parser.hpp"
+#include "server_config.hpp"
+#include "timer_wheel.hpp"
+
+// Where a socket is in its request/response cycle. The event loop drives
+// these transitions; nothing here ever blocks a thread.
+enum class ConnState { READING, PROCESSING, WRITING };
+
+// Which deadline a connection's timer is currently counting down
+enum class Timeout { NONE, HEADER, BODY, IDLE, WRITE };
+
+// Everything we know about one client socket. This is all an idle or slow
+// client costs us now (instead of a whole thread + stack).
+struct Connection {
+    int fd;
+    uint64_t id;                             // unique per loop, unlike fds
+    ConnState state = ConnState::READING;
+
+    // Request side
+    std::string in;                          // raw bytes received so far
+    HttpRequestParser parser;                // resumable parse state over `in`
+    bool peer_closed = false;                // read() returned 0
+    bool read_pending = false;               // readable edge arrived while busy
+
+    // Keep-alive bookkeeping
+    bool keep_alive = false;                 // decided per request at dispatch
+    unsigned requests_served = 0;
+
+    // One timer per connection, re-armed as it moves between phases
+    TimerNode timer;
+    Timeout timeout = Timeout::NONE;
+
+    // Response side: head and body leave together in one writev()
+    std::string head;                        // status line + headers, reused across responses
+    std::string body;                        // moved in from the worker, never copied
+    size_t sent = 0;                         // bytes of head + body written so far
+    std::shared_ptr<const StaticFile> file;  // body to sendfile() after `head`
+    off_t file_sent = 0;
+
+    // io_uring backend only: input received while we were busy, whether the
+    // kernel is still sending from head/body, and whether it closes the fd
+    std::string backlog;
+    bool send_inflight = false;
+    bool close_linked = false;
+
+    Connection(int f, uint64_t i) : fd(f), id(i) { timer.owner = this; }
+
+    // Recycle this object for a new socket. The buffers keep their
+    // capacity, so a warmed-up loop stops allocating per connection.
+    void reset(int f, uint64_t i) {
+        fd = f;
+        id = i;
+        state = ConnState::READING;
+        in.clear();
+        parser.reset();
+        peer_closed = read_pending = keep_alive = false;
+        requests_served = 0;
+        timeout = Timeout::NONE;
+        head.clear();
+        body = std::string();
+        sent = 0;
+        file.reset();
+        file_sent = 0;
+        backlog.clear();
+        send_inflight = close_linked = false;
+    }
+
+    // Queue a canned, already serialized response (errors, 503s)
+    void setResponse(const std::string& raw) {
+        head.assign(raw);
+        body.clear();
+        file.reset();
+        sent = 0;
+        file_sent = 0;
+    }
+
+    // Queue a worker's response: headers are formatted into `head` in place
+    // and the body is taken over as is.
+    void setResponse(HttpResponse&& res, const ServerConfig& cfg);
+};
+
+enum class IoStatus {
+    DONE,       // request complete / response fully written
+    AGAIN,      // socket drained (EAGAIN), wait for the next epoll event
+    CLOSED,     // peer went away or a hard socket error
+    TOO_LARGE,  // request exceeded MAX_REQUEST_SIZE
+    BAD_REQUEST // malformed; conn.parser.errorStatus() says why
+};
+
+// Non-blocking state-machine steps, called by the event loop whenever the
+// socket becomes readable/writable.
+IoStatus read_full_request(Connection& conn);
+IoStatus write_response(Connection& conn);
+
+// Resume parsing whatever is already sitting in conn.in. Used to answer
+// pipelined requests without going back to the socket.
+IoStatus parse_buffered_request(Connection& conn);
+// Drop the request we just answered and rewind the parser for the next one.
+void consume_request(Connection& conn);
+
+// HTTP/1.1 defaults to persistent connections, HTTP/1.0 has to ask.
+bool wants_keep_alive(const HttpRequest& req);
+
+// Minimal "Connection: close" response for protocol-level errors
+std::string error_response(const std::string& status);
+
+// Append the status line and headers (including the blank line) to `out`.
+// `chunked` replaces Content-Length with Transfer-Encoding: chunked.
+void format_response_head(const HttpResponse& res, bool keep_alive, const ServerConfig& cfg,
+                          std::string& out, bool chunked = false);
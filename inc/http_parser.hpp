@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include "router.hpp"
+
+constexpr size_t MAX_REQUEST_SIZE = 10 * 1024 * 1024; // 10MB limit
+constexpr size_t MAX_HEADER_SIZE = 64 * 1024;         // request line + headers
+
+// Case-insensitive ASCII compare, as header names require
+bool iequals(std::string_view a, std::string_view b);
+
+// Single-pass, resumable HTTP/1.x request parser.
+//
+// Feed it the whole receive buffer each time more bytes arrive; it picks up
+// at the first byte it hasn't seen, so every byte is examined once no matter
+// how the request is split across reads. Positions are kept as offsets (the
+// buffer may be reallocated while it grows) and only turned into
+// string_views by fill() once the request is complete.
+class HttpRequestParser {
+public:
+    enum class Result { INCOMPLETE, COMPLETE, ERROR };
+
+    Result parse(std::string_view buf);
+    void fill(HttpRequest& req, const char* base) const;
+    void reset() { *this = HttpRequestParser(); }
+
+    // Valid once parse() returned COMPLETE
+    size_t requestLength() const { return body_start + content_length; }
+    // Valid once parse() returned ERROR, e.g. "400 Bad Request"
+    const char* errorStatus() const { return error; }
+    // True once the blank line ending the headers has been seen
+    bool headersDone() const { return phase == Phase::BODY || phase == Phase::DONE; }
+
+private:
+    struct Span {
+        uint32_t off = 0, len = 0;
+        std::string_view in(const char* base) const { return {base + off, len}; }
+    };
+
+    Result fail(const char* status) { error = status; return Result::ERROR; }
+    bool reject(const char* status) { error = status; return false; }
+    bool parseRequestLine(std::string_view line, size_t off);
+    bool parseHeaderLine(std::string_view line, size_t off);
+
+    enum class Phase { REQUEST_LINE, HEADERS, BODY, DONE };
+    Phase phase = Phase::REQUEST_LINE;
+    size_t line_start = 0;      // first byte of the line being parsed
+    size_t scan = 0;            // where to resume looking for '\n'
+
+    Span method, path, version;
+    Span header_names[MAX_HEADERS];
+    Span header_values[MAX_HEADERS];
+    size_t header_count = 0;
+
+    size_t content_length = 0;
+    bool has_length = false;
+    size_t body_start = 0;
+    const char* error = nullptr;
+};
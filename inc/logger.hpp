@@ -1,31 +1,41 @@
 #pragma once
 
-#include <iostream>
+#include <atomic>
 #include <string>
-#include <mutex>
-#include <ctime>
 
-enum class LogLevel { INFO, WARN, ERR, DEBUG };
+// In order of severity: a threshold lets through its own level and above
+enum class LogLevel { DEBUG, INFO, WARN, ERR };
 
+// Lowest level compiled in at all (0 = DEBUG ... 3 = ERR). LOG() lines
+// below it are removed by the compiler; set from CMake's LOGGER_MIN_LEVEL.
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL 0
+#endif
+
+// Lines are queued on a per-thread ring and written to stdout by one
+// background thread, so logging never takes a lock shared with other
+// workers and never waits on the terminal.
 class Logger {
 public:
-    static void log(LogLevel level, const std::string& message) {
-        static std::mutex log_mutex;
-        std::lock_guard<std::mutex> lock(log_mutex);
-
-        std::time_t now = std::time(nullptr);
-        char timestamp[20];
-        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
-
-        std::string label;
-        switch (level) {
-            case LogLevel::INFO:  label = "\033[32m[INFO]\033[0m "; break;  // Green
-            case LogLevel::WARN:  label = "\033[33m[WARN]\033[0m "; break;  // Yellow
-            case LogLevel::ERR:   label = "\033[31m[FAIL]\033[0m "; break;  // Red
-            case LogLevel::DEBUG: label = "\033[36m[DEBG]\033[0m "; break;  // Cyan
-        }
-
-        std::cout << "[" << timestamp << "] " << label << message << "\n";
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= LOGGER_MIN_LEVEL &&
+               level >= threshold.load(std::memory_order_relaxed);
     }
+
+    // Runtime threshold (--log-level=); DEBUG by default
+    static void setLevel(LogLevel level) { threshold.store(level, std::memory_order_relaxed); }
+
+    // Prefer LOG(), which skips building the message when it would be
+    // dropped. Never blocks: a thread that outruns the writer loses lines,
+    // and the writer reports how many.
+    static void log(LogLevel level, std::string message);
+
+    // Writes out everything queued so far. Also runs at exit.
+    static void flush();
+
+private:
+    static std::atomic<LogLevel> threshold;
 };
 
+#define LOG(level, message) \
+    do { if (Logger::enabled(level)) Logger::log(level, message); } while (0)
@@ -3,14 +3,21 @@
 #include "template.hpp"
 #include "parser.hpp"
 #include "value.hpp"
+#include <optional>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
 struct ScriptContext {
+    ScriptContext(const HttpRequest& req, HttpResponse& res) : req(req), res(res) {}
+
     const HttpRequest& req;
     HttpResponse& res;
-    std::map<std::string, Value> vars;
+    // Script variables by slot (see ScriptResolver); empty = never assigned
+    std::vector<std::optional<Value>> locals;
+    const std::vector<std::string>* localNames = nullptr; // by slot, for templates
     std::map<std::string, std::string> form; // For POST data
+    std::map<std::string, std::string> params; // Path captures (/users/:id)
     std::map<std::string, std::vector<std::map<std::string, std::string>>> lists;
+    bool redirected = false; // res.status is "302 Found"; scripts stop at the end of the statement
 };
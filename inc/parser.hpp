@@ -1,14 +1,37 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <memory>
+#include <atomic>
+#include <optional>
+#include <cstdint>
 #include "value.hpp"
 
-struct RenderContext {
-    std::map<std::string, Value> vars;
-    // A list is a vector of maps (each map is one 'item')
-    std::map<std::string, std::vector<std::map<std::string, std::string>>> lists;
+// The variables a template sees, as a chain of frames: a lookup tries
+// this frame, then its parent. The root borrows the script's locals, and a
+// loop adds a one-variable frame per item, so nothing is ever copied.
+class RenderContext {
+public:
+    RenderContext() = default;
+    // Root frame: slot i of `values` is called names[i]; unset slots are
+    // invisible. Both must outlive the render.
+    RenderContext(const std::vector<std::string>& names, const std::vector<std::optional<Value>>& values)
+        : names(&names), values(&values) {}
+    // `name` bound to `value` (shadowing any outer one), the rest from `parent`
+    RenderContext(const RenderContext& parent, const std::string& name, const Value& value)
+        : parent(&parent), itemName(&name), item(&value) {}
+
+    // nullptr if unbound
+    const Value* find(std::string_view name) const;
+
+private:
+    const RenderContext* parent = nullptr;
+    const std::string* itemName = nullptr;
+    const Value* item = nullptr;
+    const std::vector<std::string>* names = nullptr;
+    const std::vector<std::optional<Value>>* values = nullptr;
 };
 
 class Parser {
@@ -19,28 +42,50 @@ public:
     
 };
 
+// The buffer every node of a render appends to. On its own it collects
+// the whole page; a streaming sink (a chunked HTTP response) sets
+// flushAt and takes the text in drain() whenever it grows that far.
+struct RenderSink {
+    std::string buffer;
+
+    virtual ~RenderSink() = default;
+    void write(std::string_view text) {
+        buffer.append(text);
+        if (buffer.size() >= flushAt) drain();
+    }
+
+protected:
+    size_t flushAt = SIZE_MAX;
+    // Consume `buffer` (and clear it)
+    virtual void drain() {}
+};
+
 struct Node {
     virtual ~Node() = default;
-    virtual std::string render(const RenderContext& ctx) = 0;
+    // Append this node's output to `out`
+    virtual void render(const RenderContext& ctx, RenderSink& out) const = 0;
 };
 
 struct TextNode : Node {
     std::string text;
     TextNode(std::string t) : text(t) {}
-    std::string render(const RenderContext& ctx) override;
+    void render(const RenderContext& ctx, RenderSink& out) const override;
 };
 
 struct VarNode : Node {
     std::string name;
-    VarNode(std::string n) : name(n) {}
-    std::string render(const RenderContext& ctx) override;
+    // "saint.name" split once at parse time
+    bool dotted = false;
+    std::string object, property;
+    VarNode(std::string n);
+    void render(const RenderContext& ctx, RenderSink& out) const override;
 };
 
 struct IfNode : Node {
     std::string conditionVar;
     std::vector<std::unique_ptr<Node>> children; // Renamed to match your parser
 
-    std::string render(const RenderContext& ctx) override;
+    void render(const RenderContext& ctx, RenderSink& out) const override;
 };
 
 struct ForNode : Node {
@@ -48,12 +93,44 @@ struct ForNode : Node {
     std::string listVar; // Changed to match your TemplateParser
     std::vector<std::unique_ptr<Node>> children;
 
-    std::string render(const RenderContext& ctx) override;
+    void render(const RenderContext& ctx, RenderSink& out) const override;
+};
+
+// {% cache "sidebar" user.lang 300 %}...{% endcache %}: the children's
+// output is kept in the FragmentCache under the key, built from quoted
+// strings and variables (see TemplateAot::keyPart), for the TTL in seconds
+// (at most FragmentCache::MAX_TTL)
+struct CacheNode : Node {
+    std::vector<std::unique_ptr<Node>> keyParts; // TextNode / VarNode
+    int ttl = 0;
+    std::vector<std::unique_ptr<Node>> children;
+
+    void render(const RenderContext& ctx, RenderSink& out) const override;
+};
+
+// A parsed template. Never changed after parsing, so one copy is rendered
+// by any number of threads at once.
+struct CompiledTemplate {
+    std::vector<std::unique_ptr<Node>> nodes;
+    // Set instead of `nodes` when the file is one template_compiler built
+    // into the binary (template_aot.hpp)
+    void (*compiled)(const RenderContext& ctx, RenderSink& out) = nullptr;
+
+    // What to reserve for the next whole-page render, learned from the
+    // previous ones
+    mutable std::atomic<size_t> sizeHint{0};
 };
 
 class Template {
 public:
-    static std::string render(std::string html, const RenderContext& ctx);
+    // service/<path>, parsed once and cached until the file changes;
+    // nullptr if it can't be read
+    static std::shared_ptr<const CompiledTemplate> load(const std::string& path);
+
+    static std::string render(const CompiledTemplate& tpl, const RenderContext& ctx);
+    // Same output, but written to `out` piece by piece as it's rendered
+    static void render(const CompiledTemplate& tpl, const RenderContext& ctx, RenderSink& out);
 };
 
-std::string trim(const std::string& s);
\ No newline at end of file
+std::string trim(const std::string& s);
+std::string_view trim(std::string_view s);
\ No newline at end of file
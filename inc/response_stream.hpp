@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "parser.hpp"
+#include "router.hpp"
+#include "server_config.hpp"
+
+// A response sent as it is produced, using Transfer-Encoding: chunked.
+//
+// Lives on a worker thread for the duration of one request. While the
+// request is in flight the event loop leaves the socket alone, so the
+// worker can write to it directly. A slow client makes the worker wait for
+// POLLOUT, never longer than the configured write timeout.
+class ResponseStream : public RenderSink {
+public:
+    ResponseStream(int fd, bool keep_alive, const ServerConfig& cfg)
+        : fd(fd), keep_alive(keep_alive), cfg(cfg) {}
+
+    // Send status line + headers. Nothing about `res` can change after this.
+    // From then on write() sends a chunk whenever the buffer fills up.
+    void begin(const HttpResponse& res);
+    // Flush what's left and send the terminating zero-length chunk, once
+    void finish();
+    // The page went wrong after the headers were sent: send nothing more,
+    // so the missing last chunk tells the client it is incomplete
+    void abort() { broken = true; }
+
+    bool started() const { return began; }
+    bool failed() const { return broken; }
+    // What begin() sent
+    const std::string& status() const { return sentStatus; }
+
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+private:
+    void drain() override { flush(); }
+    void flush();
+    bool sendAll(const struct iovec* iov, int count);
+
+    int fd;
+    bool keep_alive;
+    const ServerConfig& cfg;
+    bool began = false;
+    bool finished = false;
+    std::string sentStatus;
+    bool broken = false;   // client gone or too slow: drop further output
+};
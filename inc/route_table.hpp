@@ -0,0 +1,65 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct RouteConfig;
+
+// A value captured from the path: `:name` segments of tree routes, or the
+// numbered groups ("1", "2", ...) of regex routes. Views into the route
+// table and the request path.
+struct RouteParam {
+    std::string_view name;
+    std::string_view value;
+};
+
+constexpr size_t MAX_ROUTE_PARAMS = 16;
+
+struct RouteParams {
+    RouteParam items[MAX_ROUTE_PARAMS];
+    size_t count = 0;
+};
+
+// All configured routes, compiled once at load time.
+//
+// Patterns in routes.conf are looked at one by one:
+//  - plain paths ("/hello", or the old anchored style "^/hello$") and
+//    `/prefix/:param` patterns go into a radix tree per method, so a lookup
+//    costs O(path length) however many routes there are;
+//  - anything else is a real regex, compiled once and tried afterwards in
+//    file order.
+// Tree routes win over regex routes. In the tree a literal segment wins
+// over a `:param` at the same position.
+class RouteTable {
+public:
+    RouteTable();
+    ~RouteTable();
+    RouteTable(RouteTable&&) noexcept;
+    RouteTable& operator=(RouteTable&&) noexcept;
+
+    // Throws std::regex_error for a pattern that is neither kind
+    void add(const RouteConfig& route);
+
+    // nullptr if nothing matches
+    const RouteConfig* match(std::string_view method, std::string_view path, RouteParams& params) const;
+
+    size_t size() const { return routes.size(); }
+
+private:
+    struct Node;
+    struct RegexRoute {
+        std::string method;
+        std::regex pattern;
+        size_t route;
+    };
+
+    Node* insertLiteral(Node* node, std::string_view literal);
+    static const RouteConfig* matchNode(const Node& node, std::string_view path, RouteParams& params);
+
+    std::vector<std::unique_ptr<RouteConfig>> routes;   // stable addresses
+    std::map<std::string, std::unique_ptr<Node>, std::less<>> trees;
+    std::vector<RegexRoute> regexRoutes;
+};
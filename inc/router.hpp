@@ -1,16 +1,41 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <regex>
+#include <optional>
+#include "route_table.hpp"
 
+struct StaticFile;
+class ResponseStream;
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+constexpr size_t MAX_HEADERS = 64;
+
+// A parsed request. Every field is a view into the connection's receive
+// buffer, which stays untouched until the response has been sent, so
+// parsing a plain GET allocates nothing.
 struct HttpRequest {
-    std::string method;
-    std::string path;
-    std::string body;
-    std::map<std::string, std::string> headers;
-    std::map<std::string, std::string> cookies;
+    std::string_view method;
+    std::string_view path;
+    std::string_view version;
+    std::string_view body;
+    std::array<HttpHeader, MAX_HEADERS> headers;
+    size_t headerCount = 0;
+
+    // Case-insensitive; empty if the header is missing
+    std::string_view header(std::string_view name) const;
+    // Looked up straight from the Cookie header(s), nothing is pre-split
+    std::optional<std::string_view> cookie(std::string_view name) const;
 };
 
 struct HttpResponse {
@@ -20,6 +45,14 @@ struct HttpResponse {
     std::map<std::string, std::string> headers;
     std::vector<std::string> set_cookies;
 
+    // When set, the body is this file and gets sendfile()d straight from
+    // the page cache; `body` is ignored.
+    std::shared_ptr<const StaticFile> file;
+
+    // Set for routes marked `stream`: `render` writes the page straight to
+    // the client as chunks instead of into `body`.
+    ResponseStream* stream = nullptr;
+
     void add_cookie(const std::string& name, const std::string& value, const std::string& options = "Path=/; HttpOnly") {
         set_cookies.push_back(name + "=" + value + "; " + options);
     }
@@ -31,21 +64,32 @@ struct HttpResponse {
 
 struct RouteConfig {
     std::string method;
-    std::string pathRegex;
+    std::string pathRegex;      // "/path", "/users/:id" or a full regex
     std::string scriptPath;
+    bool stream = false;    // optional 4th column: "stream"
 };
 
 class Router {
 public:
+    // (Re)build the route table from service/routes.conf and publish it.
+    // Safe to call while requests are being served: they finish on the
+    // table they started with. A missing file keeps the current table.
     static void loadConfig();
-    static HttpResponse handleRequest(HttpRequest& req);
-    static std::string readFile(const std::string& path);
+    static HttpResponse handleRequest(HttpRequest& req, ResponseStream* stream = nullptr);
     static std::string getMimeType(const std::string& path); // New helper
     static void saveSession(std::string sid, std::string user);
     static std::string getUserFromSession(std::string sid);
 
 private:
-    static std::vector<RouteConfig> configRoutes;
+    // The current table, for readers: one atomic load per request, plus a
+    // refcounted copy only on the first request after a reload.
+    static std::shared_ptr<const RouteTable> routes();
+
+    // Immutable once published; swapped whole by loadConfig(). Readers
+    // only touch it (under the shared_ptr's internal lock) when
+    // `generation` says their cached copy is stale.
+    static std::shared_ptr<const RouteTable> routeTable;
+    static std::atomic<uint64_t> generation;
     static std::mutex router_mutex;
 };
 
@@ -1,26 +1,75 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include "script_lexer.hpp"
+#include "script_resolver.hpp"
+#include "script_profiler.hpp"
 #include "value.hpp" // Your Value class with operator overloads
 
+class ScriptCompiler;
+class ScriptOptimizer;
+
 class ASTNode {
 public:
+    // Source line the node starts on (0 if the parser didn't make it)
+    int line = 0;
+
     virtual ~ASTNode() = default;
-    virtual Value reduce(struct ScriptContext& ctx) = 0;
+    virtual Value reduce(struct ScriptContext& ctx) const = 0;
+
+    // What the tree-walker calls on children: reduce(), timed as a frame
+    // of its own while the profiler is on
+    Value eval(ScriptContext& ctx) const {
+        if (!ScriptProfiler::enabled() || !kind()) return reduce(ctx);
+        ScriptProfiler::Scope scope(kind(), line);
+        return reduce(ctx);
+    }
+
+    // Name in profiles; nullptr for nodes not worth a frame (blocks)
+    virtual const char* kind() const = 0;
+
+    // Emit bytecode for this node (script_compiler.cpp). Expressions leave
+    // their value in register `dst`; statements ignore it.
+    virtual void compile(ScriptCompiler& out, uint16_t dst) const = 0;
+
+    // Give names their slots (script_resolver.cpp); runs once, before any
+    // of the above
+    virtual void resolve(ScriptResolver& names) = 0;
+
+    // Simplify this subtree (script_optimizer.cpp): children first, then
+    // return a node to take this one's place, or nullptr to keep it.
+    // Runs once, right after parsing.
+    virtual std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) = 0;
+    virtual size_t nodeCount() const = 0;
+
+    // The value, if this node is a literal
+    virtual const Value* constant() const { return nullptr; }
 };
 class LiteralExpr : public ASTNode {
     Value val;
 public:
     LiteralExpr(Value v) : val(std::move(v)) {}
-    Value reduce(ScriptContext& ctx) override { return val; }
+    Value reduce(ScriptContext&) const override { return val; }
+    const char* kind() const override { return "literal"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver&) override {}
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer&) override { return nullptr; }
+    size_t nodeCount() const override { return 1; }
+    const Value* constant() const override { return &val; }
 };
 
 class VariableExpr : public ASTNode {
     std::string varName;
+    VarRef ref;
 public:
     VariableExpr(std::string name) : varName(std::move(name)) {}
-    Value reduce(ScriptContext& ctx) override; // Logic in .cpp
+    Value reduce(ScriptContext& ctx) const override; // Logic in .cpp
+    const char* kind() const override { return "variable"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
 };
 
 class BinaryExpr : public ASTNode {
@@ -28,8 +77,13 @@ class BinaryExpr : public ASTNode {
     TokenType op;
 public:
     BinaryExpr(std::unique_ptr<ASTNode> l, TokenType o, std::unique_ptr<ASTNode> r)
-        : left(std::move(l)), op(o), right(std::move(r)) {}
-    Value reduce(ScriptContext& ctx) override;
+        : left(std::move(l)), right(std::move(r)), op(o) {}
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "binary"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
 };
 
 // --- STATEMENTS (Perform an Action) ---
@@ -37,16 +91,27 @@ public:
 class BlockStmt : public ASTNode {
 public:
     std::vector<std::unique_ptr<ASTNode>> statements;
-    Value reduce(ScriptContext& ctx) override;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return nullptr; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
 };
 
 class AssignmentStmt : public ASTNode {
     std::string varName;
+    uint16_t slot = 0;
     std::unique_ptr<ASTNode> expression;
 public:
     AssignmentStmt(std::string name, std::unique_ptr<ASTNode> expr)
         : varName(std::move(name)), expression(std::move(expr)) {}
-    Value reduce(ScriptContext& ctx) override;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "set"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
 };
 
 class IfStmt : public ASTNode {
@@ -54,33 +119,94 @@ class IfStmt : public ASTNode {
 public:
     IfStmt(std::unique_ptr<ASTNode> c, std::unique_ptr<ASTNode> t, std::unique_ptr<ASTNode> e)
         : condition(std::move(c)), thenBranch(std::move(t)), elseBranch(std::move(e)) {}
-    Value reduce(ScriptContext& ctx) override;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "if"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
 };
 
+// Base of the commands; the parser picks the subclass from the keyword, so
+// nothing compares command names at run time. Each command evaluates only
+// the arguments it uses, in order.
 class CommandStmt : public ASTNode {
-    std::string command;
+protected:
     std::vector<std::unique_ptr<ASTNode>> arguments;
+
+    // Argument i, or nullptr if the script didn't give it
+    const ASTNode* arg(size_t i) const { return i < arguments.size() ? arguments[i].get() : nullptr; }
+    // Its value as a string; a missing one reads as false
+    std::string argString(ScriptContext& ctx, size_t i) const;
+public:
+    CommandStmt(std::vector<std::unique_ptr<ASTNode>> args) : arguments(std::move(args)) {}
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
+};
+
+// render "page.html"
+class RenderStmt : public CommandStmt {
+public:
+    using CommandStmt::CommandStmt;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "render"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+};
+
+// save_session sid user
+class SaveSessionStmt : public CommandStmt {
 public:
-    CommandStmt(std::string cmd, std::vector<std::unique_ptr<ASTNode>> args)
-        : command(std::move(cmd)), arguments(std::move(args)) {}
-    Value reduce(ScriptContext& ctx) override;
+    using CommandStmt::CommandStmt;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "save_session"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+};
+
+// add_cookie name value
+class AddCookieStmt : public CommandStmt {
+public:
+    using CommandStmt::CommandStmt;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "add_cookie"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+};
+
+// redirect "/url"
+class RedirectStmt : public CommandStmt {
+public:
+    using CommandStmt::CommandStmt;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "redirect"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
 };
 
 class ForStmt : public ASTNode {
     std::string itemVar;
+    uint16_t itemSlot = 0;
     std::string listName;
     std::unique_ptr<ASTNode> body;
 public:
     ForStmt(std::string var, std::string list, std::unique_ptr<ASTNode> b)
         : itemVar(std::move(var)), listName(std::move(list)), body(std::move(b)) {}
-    Value reduce(ScriptContext& ctx) override;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "for"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
 };
 
 // For lists: [1, 2, 3]
 class ListLiteralExpr : public ASTNode {
 public:
     std::vector<std::unique_ptr<ASTNode>> elements;
-    Value reduce(ScriptContext& ctx) override;
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "list"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
 };
 
 // For objects: {name: "Moses", age: 30}
@@ -88,5 +214,23 @@ class ObjectLiteralExpr : public ASTNode {
 public:
     // Key is a string, value is an ASTNode (could be a literal, variable, or another list/object)
     std::map<std::string, std::unique_ptr<ASTNode>> pairs;
-    Value reduce(ScriptContext& ctx) override;
-};
\ No newline at end of file
+    Value reduce(ScriptContext& ctx) const override;
+    const char* kind() const override { return "object"; }
+    void compile(ScriptCompiler& out, uint16_t dst) const override;
+    void resolve(ScriptResolver& names) override;
+    std::unique_ptr<ASTNode> optimize(ScriptOptimizer& opt) override;
+    size_t nodeCount() const override;
+};
+
+// --- Shared by reduce(), the optimizer and the VM (script_vm.cpp) ---
+
+// What BinaryExpr computes; throws on arithmetic with non-ints
+Value apply_binary(TokenType op, const Value& left, const Value& right);
+
+// form.x, session.x, cookie.x, param.x, or a script variable
+Value lookup_variable(ScriptContext& ctx, const VarRef& ref);
+
+void command_render(ScriptContext& ctx, const std::string& templatePath);
+void command_save_session(ScriptContext& ctx, const std::string& sid, const std::string& user);
+void command_add_cookie(ScriptContext& ctx, const std::string& key, const std::string& val);
+void command_redirect(ScriptContext& ctx, const std::string& url);
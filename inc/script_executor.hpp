@@ -2,9 +2,18 @@
 #include <string>
 #include "router.hpp" // Wherever your HttpRequest/Response live
 #include "script_parser.hpp"
+#include "server_config.hpp"
 
 class ScriptExecutor {
 public:
     // The main entry point to run a .script file
-    static void execute(const std::string& path, const HttpRequest& req, HttpResponse& res);
+    // `params` are the route's captures, readable as param.<name>
+    static void execute(const std::string& path, const HttpRequest& req, HttpResponse& res,
+                        const RouteParams& params = {});
+
+    // Set once at startup, before any request runs
+    static void setEngine(ScriptEngine e) { engine = e; }
+
+private:
+    static ScriptEngine engine;
 };
\ No newline at end of file
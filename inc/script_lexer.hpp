@@ -1,5 +1,5 @@
 #pragma once
-#include <string>
+#include <string_view>
 #include <vector>
 
 enum class TokenType {
@@ -13,21 +13,23 @@ enum class TokenType {
     LPAREN, RPAREN, L_BRACKET, R_BRACKET, L_BRACE, R_BRACE, COLON, SEMICOLON, COMMA, EOF_TOKEN
 };
 
+// `value` points into the source given to the lexer (a string's text
+// without its quotes), so that source must outlive the tokens
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value;
     int line;
 };
 
 class ScriptLexer {
-    std::string source;
+    std::string_view source;
     size_t cursor = 0;
     int line = 1;
 public:
-    ScriptLexer(std::string src) : source(std::move(src)) {}
+    ScriptLexer(std::string_view src) : source(src) {}
     std::vector<Token> tokenize();
 private:
     char peek() { return cursor < source.size() ? source[cursor] : '\0'; }
     char next() { return source[cursor++]; }
     bool isAtEnd();
-};
\ No newline at end of file
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+class ASTNode;
+
+// Load-time simplification of a parsed program, run before the resolver:
+//  - arithmetic and comparisons on literals fold into one literal, as do
+//    list/object literals made only of literals. Anything that would throw
+//    or log when run (e.g. "a" * 2, x / 0, int overflow) is left alone so
+//    it still does so at run time;
+//  - an `if` on a literal keeps only the branch it would take;
+//  - blocks absorb nested blocks and drop statements that do nothing.
+class ScriptOptimizer {
+public:
+    // Returns the number of nodes removed
+    static size_t optimize(std::unique_ptr<ASTNode>& program);
+
+    // Used by ASTNode::optimize: simplify the subtree in `slot`, replacing
+    // its root if that asks to be
+    void visit(std::unique_ptr<ASTNode>& slot);
+};
@@ -29,9 +29,9 @@ private:
     std::unique_ptr<ASTNode> parseObject();
     
     // Pratt helpers
-    Token advance() { return tokens[current++]; }
-    Token peek() { return tokens[current]; }
-    void consume(TokenType type, std::string msg);
+    const Token& advance() { return tokens[current++]; }
+    const Token& peek() const { return tokens[current]; }
+    void consume(TokenType type, const char* msg);
     bool match(TokenType type);
     
     // Binding Power lookup
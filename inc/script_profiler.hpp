@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Optional timing of script execution (--profile-scripts). Every AST node,
+// render and script run is a frame on a per-thread stack; each distinct
+// stack keeps its call count, total and self time. dump() writes them out
+// as a per-script line report and as folded stacks for flamegraph.pl.
+//
+// Off, the cost is one relaxed load per node in ASTNode::eval().
+class ScriptProfiler {
+public:
+    static bool enabled() { return on.load(std::memory_order_relaxed); }
+    static void enable(bool value) { on.store(value, std::memory_order_relaxed); }
+
+    // Times one frame from construction to destruction, nested in
+    // whichever frame is open on this thread. `line` 0 = not a node.
+    class Scope {
+    public:
+        Scope(std::string name, int line = 0);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Writes <prefix>.txt (per-script line report) and <prefix>.folded
+    // (one "frame;frame;frame self_ns" line per stack). Totals cover
+    // everything since startup.
+    static void dump(const std::string& prefix = "script_profile");
+
+private:
+    static std::atomic<bool> on;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ASTNode;
+
+// Where a name in a script reads from, decided once at load time instead
+// of by prefix checks on every access
+enum class VarScope : uint8_t { LOCAL, FORM, SESSION, COOKIE, PARAM };
+
+// A resolved name: a local by slot (ScriptContext::locals), anything else
+// by its key, i.e. the name without the "form." / "session." / ... prefix
+struct VarRef {
+    VarScope scope = VarScope::LOCAL;
+    uint16_t slot = 0;
+    std::string key;
+};
+
+// Pass over a freshly parsed program that gives every script variable a
+// slot. Names with a namespace prefix resolve to that namespace on read;
+// writes always go to a local, as they did with the old map of variables.
+class ScriptResolver {
+public:
+    // Returns the names of the local slots, by slot. Throws
+    // std::runtime_error if there are more than a slot can address.
+    static std::vector<std::string> resolve(ASTNode& program);
+
+    // Used by ASTNode::resolve
+    VarRef read(const std::string& name);
+    uint16_t write(const std::string& name);
+
+private:
+    std::vector<std::string> locals;   // by slot
+    std::unordered_map<std::string, uint16_t> slots;
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include "script_resolver.hpp"
+#include "value.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ASTNode;
+struct ScriptContext;
+
+// The instruction set. a/b/c are register numbers unless noted; a jump
+// target is an index into Bytecode::code.
+#define SCRIPT_OPS(X)                                                             \
+    X(LOAD_CONST)       /* a = constants[b]                                    */ \
+    X(LOAD_LOCAL)       /* a = local slot b                                    */ \
+    X(STORE_LOCAL)      /* local slot b = a                                    */ \
+    X(LOAD_VAR)         /* a = form/session/cookie/param refs[b]               */ \
+    X(ADD)              /* a = b + c, ints only like BinaryExpr                */ \
+    X(SUB)                                                                        \
+    X(MUL)                                                                        \
+    X(DIV)              /* a = b / c, 0 on division by zero                    */ \
+    X(EQ)               /* a = (b == c)                                        */ \
+    X(NE)                                                                         \
+    X(LT)                                                                         \
+    X(GT)                                                                         \
+    X(JUMP)             /* goto a                                              */ \
+    X(JUMP_IF_FALSE)    /* if !a goto b                                        */ \
+    X(JUMP_IF_REDIRECT) /* if the script redirected, goto a                    */ \
+    X(MAKE_LIST)        /* a = [b, b+1, ... b+c-1]                             */ \
+    X(MAKE_OBJECT)      /* a = {keySets[c][i]: b+i}                            */ \
+    X(RENDER)           /* render a                                            */ \
+    X(SAVE_SESSION)     /* save_session a b                                    */ \
+    X(ADD_COOKIE)       /* add_cookie a b                                      */ \
+    X(REDIRECT)         /* redirect a                                          */ \
+    X(LOG_ERROR)        /* log constants[a] as an error                        */ \
+    X(FOR_PREP)         /* start loops[b] with state in a, a+1; goto c if none */ \
+    X(FOR_NEXT)         /* next item of loops[b], or goto c when done          */ \
+    X(FOR_END)          /* put loops[b]'s item slot back from a                */ \
+    X(HALT)
+
+enum class Op : uint8_t {
+#define SCRIPT_OP_ENUM(name) name,
+    SCRIPT_OPS(SCRIPT_OP_ENUM)
+#undef SCRIPT_OP_ENUM
+};
+
+struct Instr {
+    Op op;
+    uint16_t a = 0, b = 0, c = 0;
+};
+
+// A compiled script: flat code plus the tables its operands index into.
+// Immutable once built, so shared between threads like the AST it came from.
+struct Bytecode {
+    struct Loop {
+        std::string list;
+        uint16_t item;
+    };
+
+    std::vector<Instr> code;
+    std::vector<Value> constants;
+    std::vector<VarRef> refs;
+    std::vector<std::vector<std::string>> keySets;
+    std::vector<Loop> loops;
+    uint16_t registers = 0;
+};
+
+// Turns a parsed program into Bytecode. Each node emits its own code via
+// ASTNode::compile(); this class holds the output and hands out registers,
+// which are used like a stack: a node takes what it needs and frees it again.
+class ScriptCompiler {
+public:
+    // Throws std::runtime_error if the script is too big to address
+    static Bytecode compile(const ASTNode& program);
+
+    // Code for a statement (null statements compile to nothing) or an
+    // expression into `dst` (null loads false, where reduce() would crash)
+    void statement(const ASTNode* node);
+    void expression(const ASTNode* node, uint16_t dst);
+
+    size_t emit(Op op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0);
+    size_t here() const { return out.code.size(); }
+    uint16_t target(size_t at) const;
+
+    uint16_t constant(Value v);
+    uint16_t ref(const VarRef& r);
+    uint16_t keySet(std::vector<std::string> keys);
+    uint16_t loop(const std::string& list, uint16_t item);
+
+    uint16_t alloc(size_t count = 1);
+    void release(uint16_t reg) { top = reg; }
+
+    Bytecode out;
+
+private:
+    uint16_t top = 0;
+};
+
+class ScriptVM {
+public:
+    static void run(const Bytecode& code, ScriptContext& ctx);
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include "logger.hpp"
+#include <sys/socket.h>
+
+// Which event loop moves the bytes (see epoll_loop.hpp / uring_loop.hpp)
+enum class IoBackend { EPOLL, URING };
+
+// What runs route scripts: the bytecode VM, or the AST interpreter it was
+// compiled from (kept as the reference to compare the VM against)
+enum class ScriptEngine { VM, AST };
+
+// Runtime knobs for the server.
+struct ServerConfig {
+    int port = 8080;
+
+    // io_uring falls back to epoll when the kernel can't do it
+    IoBackend backend = IoBackend::EPOLL;
+
+    // Accept queue length handed to listen(). The kernel caps it at
+    // net.core.somaxconn.
+    int listen_backlog = SOMAXCONN;
+
+    // Number of SO_REUSEPORT listeners, each with its own event loop and
+    // worker pool pinned to one CPU. 1 = a single classic listener.
+    unsigned shards = 1;
+
+    // Total worker threads across all shards (0 = one per core)
+    unsigned worker_threads = 0;
+
+    // Keep-alive policy: how long an idle persistent connection may sit
+    // between requests, and how many requests it may carry in total.
+    int keepalive_timeout_sec = 5;
+    unsigned keepalive_max_requests = 100;
+
+    // Deadlines enforced by each loop's timer wheel. Header and body are
+    // totals from the first byte (a slowloris can't keep them alive by
+    // trickling); write is how long a client may stall our output.
+    int header_timeout_sec = 10;
+    int body_timeout_sec = 30;
+    int write_timeout_sec = 10;
+
+    ScriptEngine script_engine = ScriptEngine::VM;
+
+    // Lines below this are dropped before they are formatted
+    LogLevel log_level = LogLevel::DEBUG;
+
+    // Time every script node; SIGUSR1 writes script_profile.txt/.folded
+    bool profile_scripts = false;
+
+    // Budget for {% cache %} fragments, keys included
+    size_t fragment_cache_mb = 16;
+
+    // Parses --port=, --backend=epoll|uring, --backlog=, --shards=, --workers=, --keepalive-timeout=,
+    // --keepalive-max=, --header-timeout=, --body-timeout=, --write-timeout=,
+    // --script-engine=vm|ast, --log-level=debug|info|warn|error, --profile-scripts
+    // and --fragment-cache-mb=.
+    // Unknown flags are reported and ignored. A timeout outside 1 second to
+    // 1 day exits with a usage error.
+    static ServerConfig fromArgs(int argc, char** argv);
+};
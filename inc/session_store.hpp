@@ -1,13 +1,17 @@
 #include <map>
+#include <mutex>
 #include <string>
 
 class SessionStore {
 public:
+    // Scripts call these from any worker thread
     static void save(const std::string& sid, const std::string& user) {
+        std::lock_guard<std::mutex> lock(mtx);
         sessions[sid] = user;
     }
 
     static std::string get(const std::string& sid) {
+        std::lock_guard<std::mutex> lock(mtx);
         if (sessions.count(sid))
             return sessions[sid];
         return "";
@@ -15,4 +19,5 @@ public:
 
 private:
     static std::map<std::string, std::string> sessions;
+    static std::mutex mtx;
 };
@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+
+// An open file under service/ plus the stat() data we serve it with.
+// Shared between the cache and any response still sending it, so an
+// eviction never closes an fd out from under sendfile().
+struct StaticFile {
+    int fd = -1;
+    off_t size = 0;
+    ino_t inode = 0;
+    time_t mtime = 0;
+    std::string mimeType;
+
+    StaticFile() = default;
+    StaticFile(const StaticFile&) = delete;
+    StaticFile& operator=(const StaticFile&) = delete;
+    ~StaticFile();
+};
+
+// LRU of open file descriptors for /static/. Entries are re-stat()ed at
+// most once per second, so edits on disk show up without a restart.
+class StaticFileCache {
+public:
+    // Returns nullptr if the file doesn't exist (or the path is unsafe)
+    static std::shared_ptr<const StaticFile> open(const std::string& path);
+
+private:
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const StaticFile> file;
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    static std::shared_ptr<const StaticFile> load(const std::string& path);
+
+    static constexpr size_t CAPACITY = 256;
+    static std::list<Entry> lru;    // front = most recently used
+    static std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    static std::mutex mtx;
+};
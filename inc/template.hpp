@@ -1,17 +1,19 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <map>
 #include "parser.hpp"
 
+// `input` must outlive the parser; the nodes it returns own their text
 class TemplateParser {
-    std::string input;
+    std::string_view input;
     size_t pos = 0;
 
 public:
-    TemplateParser(std::string in) : input(in) {}
+    TemplateParser(std::string_view in) : input(in) {}
 
-    std::vector<std::unique_ptr<Node>> parse(std::string stopTag = "");
+    std::vector<std::unique_ptr<Node>> parse(std::string_view stopTag = {});
 
 private:
-    std::unique_ptr<Node> parseTag(const std::string& content);
+    std::unique_ptr<Node> parseTag(std::string_view content);
 };
\ No newline at end of file
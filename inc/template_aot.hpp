@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "parser.hpp"
+#include "fragment_cache.hpp"
+
+// Templates compiled to C++ at build time. template_compiler turns each
+// service/*.html into a render function (aot_templates.cpp in the build
+// directory), which registers itself here before main() runs.
+// Template::load() uses one only if its file still hashes to what it was
+// compiled from, and interprets the parsed tree otherwise.
+//
+// The helpers below are the template semantics: the tree's nodes call
+// them too, so compiled and interpreted output cannot drift apart.
+class TemplateAot {
+public:
+    using RenderFn = void (*)(const RenderContext& ctx, RenderSink& out);
+
+    // From the generated code's static initializers
+    static bool add(const char* path, uint64_t sourceHash, RenderFn render);
+    // The function compiled from exactly `source` at `path`, or nullptr
+    static RenderFn find(const std::string& path, std::string_view source);
+
+    // FNV-1a, 64 bit
+    static uint64_t hash(std::string_view source);
+
+    // {{ name }}
+    static void writeVar(const RenderContext& ctx, std::string_view name, RenderSink& out);
+    // {{ object.property }}; `name` is the whole thing, looked up as is
+    // when `object` isn't an object
+    static void writeField(const RenderContext& ctx, std::string_view name, std::string_view object,
+                           const std::string& property, RenderSink& out);
+    // {% if name %}
+    static bool truthy(const RenderContext& ctx, std::string_view name);
+    // {% for x in name %}: the items, or nullptr if it isn't a list
+    static const std::vector<Value>* list(const RenderContext& ctx, std::string_view name);
+
+    // Appends one rendered part of a {% cache %} key as "<length>:<part>",
+    // so ("a:b", "c") and ("a", "b:c") can't make the same key
+    static void keyPart(RenderSink& key, std::string_view part);
+
+    // {% cache ... ttl %}: the stored fragment for `key`, or else what
+    // body(sink) renders, stored for next time
+    template <typename Body>
+    static void cached(const std::string& key, int ttl, RenderSink& out, Body&& body) {
+        if (auto html = FragmentCache::get(key)) {
+            out.write(*html);
+            return;
+        }
+        RenderSink fragment;
+        body(fragment);
+        out.write(fragment.buffer);
+        FragmentCache::put(key, std::move(fragment.buffer), std::chrono::seconds(ttl));
+    }
+};
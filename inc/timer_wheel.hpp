@@ -0,0 +1,121 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Intrusive timer: embed one in whatever needs a deadline. A node is in at
+// most one wheel slot at a time, so scheduling and cancelling are just
+// doubly-linked-list splices.
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    uint64_t expires = 0;       // in wheel ticks
+    void* owner = nullptr;
+
+    bool scheduled() const { return prev != nullptr; }
+
+    TimerNode() = default;
+    TimerNode(const TimerNode&) = delete;
+    TimerNode& operator=(const TimerNode&) = delete;
+};
+
+// Hierarchical timing wheel (4 levels x 64 slots). Schedule and cancel are
+// O(1); advancing costs O(1) per tick plus the timers that fire, with an
+// occasional cascade of one slot down a level. At the default 100ms tick it
+// covers about 19 days, far more than any connection deadline.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(100))
+        : tick(tick), start(Clock::now()) {
+        for (auto& level : slots)
+            for (auto& head : level) head.prev = head.next = &head;
+    }
+
+    // (Re)arm `t` to fire `delay` from now
+    void schedule(TimerNode& t, std::chrono::milliseconds delay) {
+        cancel(t);
+        uint64_t ticks = (delay.count() + tick.count() - 1) / tick.count();
+        t.expires = current + (ticks ? ticks : 1);
+        insert(t);
+        count++;
+    }
+
+    void cancel(TimerNode& t) {
+        if (!t.scheduled()) return;
+        t.prev->next = t.next;
+        t.next->prev = t.prev;
+        t.prev = t.next = nullptr;
+        count--;
+    }
+
+    bool empty() const { return count == 0; }
+
+    // How long epoll may sleep before the next tick is due (-1: forever)
+    int msUntilNextTick() const {
+        if (empty()) return -1;
+        auto next = start + tick * int64_t(current + 1);
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(next - Clock::now()).count();
+        return ms > 0 ? int(ms) : 0;
+    }
+
+    // Catch up with the clock, calling onExpire(TimerNode&) for each timer
+    // that came due. Callbacks may freely schedule or cancel timers.
+    template <typename F>
+    void advance(F&& onExpire) {
+        uint64_t target = (Clock::now() - start) / tick;
+        while (current < target) {
+            current++;
+
+            // Every 64 ticks, pull the next slot of the level above down
+            for (int level = 1; level < LEVELS; level++) {
+                if (current & ((uint64_t(1) << (BITS * level)) - 1)) break;
+                cascade(slots[level][(current >> (BITS * level)) & MASK]);
+            }
+
+            TimerNode& head = slots[0][current & MASK];
+            while (head.next != &head) {
+                TimerNode& t = *head.next;
+                cancel(t);
+                onExpire(t);
+            }
+        }
+    }
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int BITS = 6;
+    static constexpr uint64_t SLOTS = uint64_t(1) << BITS;
+    static constexpr uint64_t MASK = SLOTS - 1;
+
+    void insert(TimerNode& t) {
+        uint64_t delta = t.expires - current;
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (uint64_t(1) << (BITS * (level + 1)))) level++;
+        if (level == LEVELS - 1 && delta >= (uint64_t(1) << (BITS * LEVELS))) {
+            t.expires = current + (uint64_t(1) << (BITS * LEVELS)) - 1; // clamp to the horizon
+        }
+
+        TimerNode& head = slots[level][(t.expires >> (BITS * level)) & MASK];
+        t.next = &head;
+        t.prev = head.prev;
+        head.prev->next = &t;
+        head.prev = &t;
+    }
+
+    void cascade(TimerNode& head) {
+        TimerNode* t = head.next;
+        head.prev = head.next = &head;
+        while (t != &head) {
+            TimerNode* next = t->next;
+            insert(*t);
+            t = next;
+        }
+    }
+
+    std::chrono::milliseconds tick;
+    Clock::time_point start;
+    uint64_t current = 0;       // ticks since start that have been processed
+    size_t count = 0;
+    TimerNode slots[LEVELS][SLOTS];
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <linux/io_uring.h>
+#include "event_loop.hpp"
+
+// io_uring backend (Linux 6.0+), driven through the raw syscalls so there's
+// no liburing dependency. Per loop it keeps:
+//  - one multishot accept on the listener, so a new client costs no SQE;
+//  - one multishot recv per connection, reading into a provided buffer ring
+//    shared by every socket (bytes are copied into conn.in straight away and
+//    the buffer goes back to the ring);
+//  - linked send -> send -> cancel -> close chains, so a "Connection: close"
+//    response is written and the socket torn down in a single submission.
+// Static files still go out with sendfile(), polled through the ring when
+// the socket is full, since io_uring has no sendfile opcode.
+class UringLoop : public EventLoop {
+public:
+    // Throws std::runtime_error if the kernel lacks anything we rely on
+    UringLoop(int listen_fd, WorkerPool& pool, const ServerConfig& cfg);
+    ~UringLoop() override;
+
+    void run() override;
+
+protected:
+    void startWrite(Connection& conn) override;
+    IoStatus readPending(Connection& conn) override;
+    void abandonSocket(Connection& conn) override;
+    void closeSocket(std::unique_ptr<Connection> conn) override;
+
+private:
+    // What a completion belongs to; packed into the low bits of user_data
+    // next to the conn id.
+    enum Op : uint64_t { ACCEPT, WAKE, RECV, SEND, POLL, IGNORE };
+
+    void setup();
+    void release();
+
+    io_uring_sqe* nextSqe(uint64_t id, Op op);
+    void reserve(unsigned count);
+    void submit(int wait_ms);
+    void onCompletion(const io_uring_cqe& cqe);
+
+    void armAccept();
+    void armWake();
+    void armRecv(Connection& conn);
+    void queueClose(int fd);
+
+    void onRecv(uint64_t id, int res, unsigned flags);
+    void onSend(uint64_t id, int res);
+    void returnBuffer(unsigned bid);
+
+    // Submission/completion rings, mapped from the kernel
+    int ring_fd = -1;
+    void* ring_map = nullptr;
+    size_t ring_map_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned pending = 0;       // SQEs queued since the last io_uring_enter
+
+    // Provided receive buffers
+    io_uring_buf_ring* buf_ring = nullptr;
+    size_t buf_ring_size = 0;
+    char* buffers = nullptr;
+    unsigned short buf_tail = 0;
+
+    // Closed while the kernel was still sending from their buffers
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> closing;
+};
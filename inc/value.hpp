@@ -1,21 +1,25 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <variant>
 #include <stdexcept>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 
-template<class... Ts> 
+template<class... Ts>
 struct Overload : Ts... {
-     using Ts::operator()...; 
+     using Ts::operator()...;
 };
 
 template<class... Ts> Overload(Ts...) -> Overload<Ts...>;
 
 
 struct DataValue {
-    std::variant<std::string, 
-                 std::vector<DataValue>, 
+    std::variant<std::string,
+                 std::vector<DataValue>,
                  std::map<std::string, DataValue>> data;
 
     // Helpers to create/check types
@@ -25,60 +29,74 @@ struct DataValue {
 
     std::string toString() const {
         if (isString()) return std::get<std::string>(data);
-        return "[Complex Object]"; 
+        return "[Complex Object]";
     }
 };
 
+// Thrown by the as...() accessors on the wrong type. Same type and message
+// as the std::get failure it replaces, which scripts' error pages show.
+struct ValueTypeError : std::bad_variant_access {
+    const char* what() const noexcept override { return "std::get: wrong index for variant"; }
+};
 
-
+// A script value in 16 bytes. Ints, bools and strings of up to 14 bytes
+// live inline; longer strings, lists and objects are immutable nodes shared
+// by reference count, so copying any Value never allocates. The counts are
+// atomic because compiled constants are shared between worker threads.
+//
+// Note that Value("") is a bool (true): const char* converts to bool before
+// std::string. Scripts rely on it for missing variables.
 class Value {
 public:
+    enum class Type : uint8_t { BOOL, INT, STRING, LIST, OBJECT };
+
+    Value() { setBool(false); }
+    Value(int v) { setType(Type::INT); store(v); }
+    Value(std::string v);
+    Value(bool v) { setBool(v); }
+    Value(std::vector<Value> v);
+    Value(std::map<std::string, Value> v);
+
+    Value(const Value& other) { std::memcpy(bytes, other.bytes, SIZE); retain(); }
+    Value(Value&& other) noexcept { std::memcpy(bytes, other.bytes, SIZE); other.setBool(false); }
+    Value& operator=(const Value& other) {
+        if (this != &other) { other.retain(); release(); std::memcpy(bytes, other.bytes, SIZE); }
+        return *this;
+    }
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) { release(); std::memcpy(bytes, other.bytes, SIZE); other.setBool(false); }
+        return *this;
+    }
+    ~Value() { release(); }
 
-    std::variant<int, 
-                std::string, 
-                bool,
-                std::vector<Value>,
-                std::map<std::string, Value>,
-                std::monostate> data;
-
-    Value() : data(false) {}
-    Value(int v) : data(v) {}
-    Value(std::string v) : data(v) {}
-    Value(bool v) : data(v) {}
-    Value(std::vector<Value> v): data(v) {}
-    Value(std::map<std::string, Value> v): data (v) {}
-
-    bool isInt() const { return std::holds_alternative<int>(data); }
-    bool isString() const { return std::holds_alternative<std::string>(data); }
-
+    Type type() const { return static_cast<Type>(bytes[TYPE_BYTE]); }
+    bool isInt() const { return type() == Type::INT; }
+    bool isString() const { return type() == Type::STRING; }
+    bool isList() const { return type() == Type::LIST; }
+    bool isObject() const { return type() == Type::OBJECT; }
 
-    int asInt() const { return std::get<int>(data); }
+    int asInt() const {
+        if (!isInt()) throw ValueTypeError();
+        return load<int>();
+    }
     int toInt() const {
-        if (auto* i = std::get_if<int>(&data)) return *i;
-        if (auto* s = std::get_if<std::string>(&data)) {
-            try { return std::stoi(*s); } catch (...) { return 0; }
+        if (isInt()) return load<int>();
+        if (isString()) {
+            try { return std::stoi(asString()); } catch (...) { return 0; }
         }
         return 0;
     }
 
-    std::string asString() const {
-        if (auto* s = std::get_if<std::string>(&data)) return *s;
-        if (auto* i = std::get_if<int>(&data)) return std::to_string(*i);
-        if (auto* b = std::get_if<bool>(&data)) return *b ? "true" : "false";
-        if (isList()) return "[List]";
-        if (isObject()) return "[Object]";
-        return "";
-    }
+    // The text of a string without copying it; empty for other types
+    std::string_view stringView() const;
+    std::string asString() const;
 
-    bool isList() const { return std::holds_alternative<std::vector<Value>>(data);}
-    const std::vector<Value>& asList() const { return std::get<std::vector<Value>>(data);}
-
-    bool isObject() const { return std::holds_alternative<std::map<std::string, Value>>(data);}
-    const std::map<std::string, Value>& asObject() const { return std::get<std::map<std::string, Value>>(data);}
+    const std::vector<Value>& asList() const;
+    const std::map<std::string, Value>& asObject() const;
 
     // Example of a "reduce" helper for math
     Value operator+(const Value& other) const {
-        if (this->isInt() && other.isInt()) 
+        if (this->isInt() && other.isInt())
             return Value(this->asInt() + other.asInt());
         // String concatenation fallback
         return Value(this->asString() + other.asString());
@@ -90,7 +108,7 @@ public:
 
     Value operator*(const Value& other) const {
         if (isInt() && other.isInt()) return Value(asInt() * other.asInt());
-        return Value(); 
+        return Value();
     }
 
     Value operator/(const Value& other) const {
@@ -98,26 +116,82 @@ public:
         return Value();
     }
 
-    // Comparisons
-    bool operator==(const Value& other) const { return data == other.data; }
-    bool operator!=(const Value& other) const { return data != other.data; }
-    
+    // Comparisons: equal only if the same type with equal contents
+    bool operator==(const Value& other) const;
+    bool operator!=(const Value& other) const { return !(*this == other); }
+
     bool operator<(const Value& other) const {
         if (isInt() && other.isInt()) return asInt() < other.asInt();
-        if (isString() && other.isString()) return asString() < other.asString();
+        if (isString() && other.isString()) return stringView() < other.stringView();
         return false;
     }
 
     bool operator>(const Value& other) const { return other < *this; }
 
     // Truthiness helper for If/For logic
-    bool isTruthy() const {
-        if (std::holds_alternative<bool>(data)) return std::get<bool>(data);
-        if (isInt()) return asInt() != 0;
-        if (isString()) return !std::get<std::string>(data).empty();
-        if (isList()) return !asList().empty();
-        if (isObject()) return !asObject().empty();
-        if (std::holds_alternative<std::monostate>(data)) return false;
-        return false;
+    bool isTruthy() const;
+
+private:
+    struct Shared {
+        std::atomic<uint32_t> refs{1};
+    };
+    struct StringData;
+    struct ListData;
+    struct ObjectData;
+
+    // bytes[0..13]: int, bool, Shared* or inline chars;
+    // bytes[14]: inline string length, or HEAP; bytes[15]: Type
+    static constexpr size_t SIZE = 16;
+    static constexpr size_t INLINE_CHARS = 14;
+    static constexpr size_t LEN_BYTE = 14;
+    static constexpr size_t TYPE_BYTE = 15;
+    static constexpr uint8_t HEAP = 0xFF;
+
+    alignas(8) unsigned char bytes[SIZE];
+
+    template <typename T> T load() const { T v; std::memcpy(&v, bytes, sizeof(T)); return v; }
+    template <typename T> void store(T v) { std::memcpy(bytes, &v, sizeof(T)); }
+
+    void setType(Type t) { bytes[TYPE_BYTE] = static_cast<unsigned char>(t); bytes[LEN_BYTE] = 0; }
+    void setBool(bool v) { setType(Type::BOOL); store(v); }
+    void setShared(Type t, Shared* node) { setType(t); bytes[LEN_BYTE] = HEAP; store(node); }
+
+    bool shared() const { return bytes[LEN_BYTE] == HEAP; }
+    Shared* node() const { return load<Shared*>(); }
+
+    void retain() const {
+        if (shared()) node()->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    void release() {
+        if (shared() && node()->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) destroy();
     }
-};
\ No newline at end of file
+    void destroy();
+};
+
+static_assert(sizeof(Value) == 16, "Value should stay two words");
+
+struct Value::StringData : Value::Shared {
+    std::string text;
+};
+struct Value::ListData : Value::Shared {
+    std::vector<Value> items;
+};
+struct Value::ObjectData : Value::Shared {
+    std::map<std::string, Value> fields;
+};
+
+inline std::string_view Value::stringView() const {
+    if (!isString()) return {};
+    if (shared()) return static_cast<const StringData*>(node())->text;
+    return std::string_view(reinterpret_cast<const char*>(bytes), bytes[LEN_BYTE]);
+}
+
+inline const std::vector<Value>& Value::asList() const {
+    if (!isList()) throw ValueTypeError();
+    return static_cast<const ListData*>(node())->items;
+}
+
+inline const std::map<std::string, Value>& Value::asObject() const {
+    if (!isObject()) throw ValueTypeError();
+    return static_cast<const ObjectData*>(node())->fields;
+}
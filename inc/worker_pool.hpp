@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "router.hpp"
+#include "bounded_queue.hpp"
+
+class EventLoop;
+
+// Pin the calling thread to one CPU. Best effort: failures are logged.
+void pin_current_thread(int cpu);
+
+// A parsed request waiting for a worker, plus enough to route the answer
+// back to the connection it came from.
+struct RequestJob {
+    HttpRequest req;
+    EventLoop* origin = nullptr;
+    int fd = -1;
+    uint64_t conn_id = 0;   // guards against the fd being reused meanwhile
+    bool keep_alive = false;
+};
+
+// Fixed set of threads running Router::handleRequest (scripts + templates).
+// The event loop only ever talks to it through trySubmit(), so a traffic
+// spike turns into 503s instead of unbounded threads.
+class WorkerPool {
+public:
+    // cpu >= 0 pins every worker to that CPU (used by sharded listeners)
+    WorkerPool(size_t threads, size_t queue_capacity, int cpu = -1);
+    ~WorkerPool();
+
+    bool trySubmit(RequestJob&& job) { return queue.tryPush(std::move(job)); }
+    size_t size() const { return workers.size(); }
+
+private:
+    void workerLoop(int cpu);
+
+    BoundedQueue<RequestJob> queue;
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,86 @@
+#include "config_watcher.hpp"
+#include "router.hpp"
+#include "logger.hpp"
+#include "script_profiler.hpp"
+#include "fragment_cache.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <thread>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+// SIGUSR1: report the runtime counters
+static void dump_stats() {
+    LOG(LogLevel::INFO, FragmentCache::describe());
+    if (ScriptProfiler::enabled()) ScriptProfiler::dump();
+}
+
+static void watch_loop(int sig_fd, int inotify_fd, std::string file) {
+    pollfd fds[2] = {{sig_fd, POLLIN, 0}, {inotify_fd, POLLIN, 0}};
+    int count = inotify_fd >= 0 ? 2 : 1;
+
+    while (true) {
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) continue;
+            LOG(LogLevel::ERR, "Config watcher stopped: " + std::string(strerror(errno)));
+            return;
+        }
+
+        bool reload = false;
+        if (fds[0].revents & POLLIN) {
+            signalfd_siginfo info;
+            while (read(sig_fd, &info, sizeof(info)) == sizeof(info)) {
+                if (info.ssi_signo == SIGHUP) reload = true;
+                if (info.ssi_signo == SIGUSR1) dump_stats();
+            }
+            if (reload) LOG(LogLevel::INFO, "SIGHUP: reloading routes");
+        }
+
+        if (count == 2 && (fds[1].revents & POLLIN)) {
+            alignas(inotify_event) char buf[4096];
+            ssize_t n;
+            while ((n = read(inotify_fd, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + n;) {
+                    auto* ev = reinterpret_cast<inotify_event*>(p);
+                    if (ev->len && file == ev->name) reload = true;
+                    p += sizeof(inotify_event) + ev->len;
+                }
+            }
+            if (reload) LOG(LogLevel::INFO, file + " changed: reloading routes");
+        }
+
+        if (reload) Router::loadConfig();
+    }
+}
+
+void ConfigWatcher::start(const std::string& dir, const std::string& file) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    int sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sig_fd < 0) {
+        LOG(LogLevel::ERR, "signalfd failed, no hot reload: " + std::string(strerror(errno)));
+        return;
+    }
+
+    // Whole directory: a save may replace routes.conf rather than write it
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd >= 0 &&
+        inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    if (inotify_fd < 0) {
+        LOG(LogLevel::WARN, "Not watching " + dir + "/" + file + ", reload with SIGHUP: " +
+                    std::string(strerror(errno)));
+    }
+
+    std::thread(watch_loop, sig_fd, inotify_fd, file).detach();
+}
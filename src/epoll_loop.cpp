@@ -0,0 +1,132 @@
+#include "epoll_loop.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// epoll_event.data tags for the two non-client fds (conn ids start at 1)
+static constexpr uint64_t LISTEN_TAG = 0;
+static constexpr uint64_t WAKE_TAG = ~uint64_t(0);
+
+EpollLoop::EpollLoop(int lfd, WorkerPool& p, const ServerConfig& c) : EventLoop(lfd, p, c) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) throw std::runtime_error("epoll_create1 failed: " + std::string(strerror(errno)));
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = LISTEN_TAG;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) < 0)
+        throw std::runtime_error("epoll_ctl(listen) failed: " + std::string(strerror(errno)));
+
+    ev.data.u64 = WAKE_TAG;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) < 0)
+        throw std::runtime_error("epoll_ctl(eventfd) failed: " + std::string(strerror(errno)));
+}
+
+EpollLoop::~EpollLoop() {
+    if (epoll_fd >= 0) close(epoll_fd);
+}
+
+void EpollLoop::run() {
+    epoll_event events[256];
+
+    while (true) {
+        // Sleep until the next wheel tick at most, so deadlines fire on time
+        int n = epoll_wait(epoll_fd, events, 256, timers.msUntilNextTick());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG(LogLevel::ERR, "epoll_wait failed: " + std::string(strerror(errno)));
+            return;
+        }
+        expireTimers();
+
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG) {
+                acceptConnections();
+                continue;
+            }
+            if (tag == WAKE_TAG) {
+                drainCompletions();
+                continue;
+            }
+
+            Connection* conn = findConnection(tag);
+            if (!conn) continue;
+
+            // Note: EPOLLRDHUP alone isn't fatal; a client may half-close
+            // after sending its request and still expect the answer.
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(*conn);
+                continue;
+            }
+            // A readable event may finish the whole exchange and close the
+            // socket, so look the connection up again before writing.
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP)) onReadable(*conn);
+            if ((events[i].events & EPOLLOUT) && (conn = findConnection(tag))) onWritable(*conn);
+        }
+    }
+}
+
+void EpollLoop::acceptConnections() {
+    // Edge-triggered listener: accept until the backlog is empty
+    while (true) {
+        int client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                LOG(LogLevel::WARN, "accept failed: " + std::string(strerror(errno)));
+            return;
+        }
+
+        Connection& conn = addConnection(client_fd);
+
+        // Register for both directions once; with EPOLLET we only hear about
+        // transitions, so there's no need to flip interest back and forth.
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = conn.id;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) < 0) closeConnection(conn);
+    }
+}
+
+void EpollLoop::onReadable(Connection& conn) {
+    if (conn.state != ConnState::READING) {
+        // Busy with the previous request; pick these bytes up afterwards
+        conn.read_pending = true;
+        return;
+    }
+    onRequestStatus(conn, read_full_request(conn));
+}
+
+void EpollLoop::onWritable(Connection& conn) {
+    if (conn.state != ConnState::WRITING) return;
+
+    // AGAIN: the kernel buffer is full, EPOLLOUT will call us back
+    switch (write_response(conn)) {
+        case IoStatus::AGAIN:
+            // Re-armed on every bit of progress: only a stalled client trips it
+            armTimer(conn, Timeout::WRITE);
+            return;
+        case IoStatus::DONE:
+            finishResponse(conn);
+            return;
+        default:
+            closeConnection(conn);
+            return;
+    }
+}
+
+void EpollLoop::abandonSocket(Connection& conn) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn.fd, nullptr);
+    shutdown(conn.fd, SHUT_RDWR);
+}
+
+void EpollLoop::closeSocket(std::unique_ptr<Connection> conn) {
+    // Closing the fd also drops it from the epoll set
+    close(conn->fd);
+    recycle(std::move(conn));
+}
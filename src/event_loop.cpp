@@ -0,0 +1,256 @@
+#include "event_loop.hpp"
+#include "epoll_loop.hpp"
+#include "uring_loop.hpp"
+#include "worker_pool.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static const std::string PAYLOAD_TOO_LARGE =
+    "HTTP/1.1 413 Payload Too Large\r\nContent-Type: text/html\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static const std::string REQUEST_TIMEOUT =
+    "HTTP/1.1 408 Request Timeout\r\nContent-Type: text/html\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static constexpr size_t MAX_SPARE_CONNECTIONS = 1024;
+
+// Prebuilt so shedding load costs nothing but a send()
+static const std::string SERVICE_UNAVAILABLE =
+    "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/html\r\nContent-Length: 0\r\nRetry-After: 1\r\nConnection: close\r\n\r\n";
+
+std::unique_ptr<EventLoop> EventLoop::create(int listen_fd, WorkerPool& pool, const ServerConfig& cfg) {
+    if (cfg.backend == IoBackend::URING) {
+        try {
+            return std::make_unique<UringLoop>(listen_fd, pool, cfg);
+        } catch (const std::exception& e) {
+            LOG(LogLevel::WARN, std::string("io_uring unavailable, using epoll: ") + e.what());
+        }
+    }
+    return std::make_unique<EpollLoop>(listen_fd, pool, cfg);
+}
+
+EventLoop::EventLoop(int lfd, WorkerPool& p, const ServerConfig& c) : listen_fd(lfd), pool(p), cfg(c) {
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) throw std::runtime_error("eventfd failed: " + std::string(strerror(errno)));
+}
+
+EventLoop::~EventLoop() {
+    for (auto& [id, conn] : connections) close(conn->fd);
+    for (auto& [id, conn] : orphaned) close(conn->fd);
+    if (wake_fd >= 0) close(wake_fd);
+}
+
+Connection& EventLoop::addConnection(int fd) {
+    std::unique_ptr<Connection> conn;
+    if (!spare_connections.empty()) {
+        conn = std::move(spare_connections.back());
+        spare_connections.pop_back();
+        conn->reset(fd, next_conn_id++);
+    } else {
+        conn = std::make_unique<Connection>(fd, next_conn_id++);
+    }
+    armTimer(*conn, Timeout::HEADER);
+
+    Connection& ref = *conn;
+    connections[ref.id] = std::move(conn);
+    return ref;
+}
+
+Connection* EventLoop::findConnection(uint64_t conn_id) {
+    auto it = connections.find(conn_id);
+    return it == connections.end() ? nullptr : it->second.get();
+}
+
+void EventLoop::onRequestStatus(Connection& conn, IoStatus status) {
+    switch (status) {
+        case IoStatus::AGAIN:
+            // Still waiting: the first bytes of a request start the header
+            // clock, finishing the headers starts the body clock.
+            if (conn.parser.headersDone()) {
+                if (conn.timeout != Timeout::BODY) armTimer(conn, Timeout::BODY);
+            } else if (!conn.in.empty() && conn.timeout != Timeout::HEADER) {
+                armTimer(conn, Timeout::HEADER);
+            }
+            return;
+        case IoStatus::CLOSED:
+            closeConnection(conn);
+            return;
+        case IoStatus::TOO_LARGE:
+            LOG(LogLevel::WARN, "Request too large, rejecting");
+            conn.setResponse(PAYLOAD_TOO_LARGE);
+            conn.keep_alive = false;
+            conn.state = ConnState::WRITING;
+            startWrite(conn);
+            return;
+        case IoStatus::BAD_REQUEST:
+            LOG(LogLevel::WARN, std::string("Rejecting request: ") + conn.parser.errorStatus());
+            conn.setResponse(error_response(conn.parser.errorStatus()));
+            conn.keep_alive = false;
+            conn.state = ConnState::WRITING;
+            startWrite(conn);
+            return;
+        case IoStatus::DONE:
+            dispatch(conn);
+            return;
+    }
+}
+
+void EventLoop::dispatch(Connection& conn) {
+    // The request's views point into conn.in, which nobody touches until
+    // the response has gone out (or the worker is done with an orphan).
+    RequestJob job;
+    conn.parser.fill(job.req, conn.in.data());
+    job.origin = this;
+    job.fd = conn.fd;
+    job.conn_id = conn.id;
+
+    conn.requests_served++;
+    conn.keep_alive = wants_keep_alive(job.req) &&
+                      conn.requests_served < cfg.keepalive_max_requests;
+    job.keep_alive = conn.keep_alive;
+
+    if (pool.trySubmit(std::move(job))) {
+        // The socket sits idle until the worker hands the response back.
+        // Scripts can't be interrupted, so no deadline while they run.
+        conn.state = ConnState::PROCESSING;
+        timers.cancel(conn.timer);
+        conn.timeout = Timeout::NONE;
+        return;
+    }
+
+    // Backpressure: every worker is busy and the queue is full
+    LOG(LogLevel::WARN, "Worker queue full, shedding request");
+    conn.setResponse(SERVICE_UNAVAILABLE);
+    conn.keep_alive = false;
+    conn.state = ConnState::WRITING;
+    startWrite(conn);
+}
+
+void EventLoop::complete(int fd, uint64_t conn_id, HttpResponse&& response, Delivery delivery) {
+    {
+        std::lock_guard<std::mutex> lock(completions_mutex);
+        completions.push_back({fd, conn_id, std::move(response), delivery});
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void EventLoop::drainCompletions() {
+    uint64_t count;
+    while (read(wake_fd, &count, sizeof(count)) > 0) {}
+
+    std::vector<Completion> ready;
+    {
+        std::lock_guard<std::mutex> lock(completions_mutex);
+        ready.swap(completions);
+    }
+
+    for (auto& c : ready) {
+        Connection* found = findConnection(c.conn_id);
+        if (!found) {
+            // The client went away while the worker was busy
+            auto orphan = orphaned.find(c.conn_id);
+            if (orphan != orphaned.end()) {
+                std::unique_ptr<Connection> conn = std::move(orphan->second);
+                orphaned.erase(orphan);
+                closeSocket(std::move(conn));
+            }
+            continue;
+        }
+
+        Connection& conn = *found;
+        conn.state = ConnState::WRITING;
+        if (c.delivery == Delivery::STREAMED) {
+            finishResponse(conn);
+        } else if (c.delivery == Delivery::STREAM_FAILED) {
+            closeConnection(conn);
+        } else {
+            conn.setResponse(std::move(c.response), cfg);
+            startWrite(conn);
+        }
+    }
+}
+
+void EventLoop::finishResponse(Connection& conn) {
+    if (!conn.keep_alive) {
+        closeConnection(conn);
+        return;
+    }
+
+    consume_request(conn);
+    conn.state = ConnState::READING;
+    armTimer(conn, conn.in.empty() ? Timeout::IDLE : Timeout::HEADER);
+
+    // Pipelined requests are already in our buffer: answer them in order
+    // straight away, no syscall needed.
+    IoStatus st = parse_buffered_request(conn);
+    if (st != IoStatus::AGAIN || !conn.read_pending) {
+        onRequestStatus(conn, st);
+        return;
+    }
+    // More input turned up while we were busy, so go and look now
+    onRequestStatus(conn, readPending(conn));
+}
+
+void EventLoop::armTimer(Connection& conn, Timeout kind) {
+    int seconds = 0;
+    switch (kind) {
+        case Timeout::HEADER: seconds = cfg.header_timeout_sec; break;
+        case Timeout::BODY:   seconds = cfg.body_timeout_sec; break;
+        case Timeout::IDLE:   seconds = cfg.keepalive_timeout_sec; break;
+        case Timeout::WRITE:  seconds = cfg.write_timeout_sec; break;
+        case Timeout::NONE:   break;
+    }
+    conn.timeout = kind;
+    timers.schedule(conn.timer, std::chrono::seconds(seconds));
+}
+
+void EventLoop::expireTimers() {
+    timers.advance([this](TimerNode& t) { onTimeout(*static_cast<Connection*>(t.owner)); });
+}
+
+void EventLoop::onTimeout(Connection& conn) {
+    Timeout kind = conn.timeout;
+    conn.timeout = Timeout::NONE;
+
+    // A half-received request gets told why; anything else just hangs up
+    if ((kind == Timeout::HEADER || kind == Timeout::BODY) && !conn.in.empty()) {
+        LOG(LogLevel::WARN, kind == Timeout::HEADER ? "Timed out reading headers"
+                                                            : "Timed out reading body");
+        conn.setResponse(REQUEST_TIMEOUT);
+        conn.keep_alive = false;
+        conn.state = ConnState::WRITING;
+        startWrite(conn);
+        return;
+    }
+    closeConnection(conn);
+}
+
+void EventLoop::closeConnection(Connection& conn) {
+    auto it = connections.find(conn.id);
+    timers.cancel(conn.timer);
+
+    if (conn.state == ConnState::PROCESSING) {
+        // A worker still holds views into conn.in. Hang up on the client
+        // but keep the buffer (and the fd number) until the job completes.
+        abandonSocket(conn);
+        orphaned[conn.id] = std::move(it->second);
+        connections.erase(it);
+        return;
+    }
+
+    std::unique_ptr<Connection> owned = std::move(it->second);
+    connections.erase(it);
+    closeSocket(std::move(owned));
+}
+
+void EventLoop::recycle(std::unique_ptr<Connection> conn) {
+    // Keep a bounded number around; big buffers aren't worth hoarding
+    if (spare_connections.size() < MAX_SPARE_CONNECTIONS && conn->in.capacity() <= 64 * 1024) {
+        spare_connections.push_back(std::move(conn));
+    }
+}
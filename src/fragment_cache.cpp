@@ -0,0 +1,106 @@
+#include "fragment_cache.hpp"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+struct FragmentShard {
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const std::string> html;
+        Clock::time_point expires;
+        size_t bytes() const { return key.size() + html->size(); }
+    };
+
+    std::mutex mtx;
+    std::list<Entry> lru; // front = most recently used
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t bytes = 0;
+    uint64_t hits = 0, misses = 0, evictions = 0;
+
+    void erase(std::list<Entry>::iterator it) {
+        bytes -= it->bytes();
+        index.erase(it->key);
+        lru.erase(it);
+    }
+};
+
+static FragmentShard shards[FragmentCache::SHARDS];
+static std::atomic<size_t> shard_capacity{(16u << 20) / FragmentCache::SHARDS};
+
+static FragmentShard& shard_for(const std::string& key) {
+    return shards[std::hash<std::string>{}(key) % FragmentCache::SHARDS];
+}
+
+void FragmentCache::setCapacity(size_t bytes) {
+    shard_capacity.store(bytes / SHARDS, std::memory_order_relaxed);
+}
+
+std::shared_ptr<const std::string> FragmentCache::get(const std::string& key) {
+    FragmentShard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        shard.misses++;
+        return nullptr;
+    }
+    if (Clock::now() >= it->second->expires) {
+        shard.erase(it->second);
+        shard.misses++;
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    shard.hits++;
+    return it->second->html;
+}
+
+void FragmentCache::put(const std::string& key, std::string html, std::chrono::seconds ttl) {
+    size_t capacity = shard_capacity.load(std::memory_order_relaxed);
+    if (ttl.count() <= 0 || key.size() + html.size() > capacity) return;
+    ttl = std::min(ttl, std::chrono::seconds(MAX_TTL));
+
+    FragmentShard::Entry entry{key, std::make_shared<const std::string>(std::move(html)), Clock::now() + ttl};
+    FragmentShard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    // Two renders that missed together both store; the later one wins
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) shard.erase(it->second);
+
+    shard.bytes += entry.bytes();
+    shard.lru.push_front(std::move(entry));
+    shard.index[key] = shard.lru.begin();
+
+    while (shard.bytes > capacity) {
+        shard.erase(std::prev(shard.lru.end()));
+        shard.evictions++;
+    }
+}
+
+FragmentCache::Stats FragmentCache::stats() {
+    Stats total;
+    for (FragmentShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        total.hits += shard.hits;
+        total.misses += shard.misses;
+        total.evictions += shard.evictions;
+        total.entries += shard.lru.size();
+        total.bytes += shard.bytes;
+    }
+    return total;
+}
+
+std::string FragmentCache::describe() {
+    Stats s = stats();
+    uint64_t lookups = s.hits + s.misses;
+    std::string rate = lookups ? std::to_string(s.hits * 100 / lookups) + "%" : "-";
+    return "Fragment cache: " + std::to_string(s.hits) + " hits, " + std::to_string(s.misses) + " misses (" +
+           rate + " hit rate), " + std::to_string(s.evictions) + " evictions, " + std::to_string(s.entries) +
+           " entries, " + std::to_string(s.bytes) + " of " +
+           std::to_string(shard_capacity.load(std::memory_order_relaxed) * SHARDS) + " bytes";
+}
@@ -0,0 +1,144 @@
+#include "http.hpp"
+#include "static_files.hpp"
+#include <cerrno>
+#include <charconv>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+IoStatus parse_buffered_request(Connection& conn) {
+    switch (conn.parser.parse(conn.in)) {
+        case HttpRequestParser::Result::COMPLETE:   return IoStatus::DONE;
+        case HttpRequestParser::Result::ERROR:      return IoStatus::BAD_REQUEST;
+        default: break;
+    }
+    return conn.peer_closed ? IoStatus::CLOSED : IoStatus::AGAIN;
+}
+
+void consume_request(Connection& conn) {
+    conn.in.erase(0, conn.parser.requestLength());
+    conn.parser.reset();
+    conn.setResponse(std::string());
+    conn.body = std::string();   // the worker's buffer, not ours to keep
+}
+
+bool wants_keep_alive(const HttpRequest& req) {
+    std::string_view connection = req.header("Connection");
+    if (req.version == "HTTP/1.1") return !iequals(connection, "close");
+    return iequals(connection, "keep-alive");
+}
+
+std::string error_response(const std::string& status) {
+    return "HTTP/1.1 " + status + "\r\nContent-Type: text/html\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+}
+
+IoStatus read_full_request(Connection& conn) {
+    constexpr size_t CHUNK = 16 * 1024;
+
+    // 1. Drain the socket straight into the connection buffer. We're
+    //    edge-triggered, so we must read until EAGAIN or we won't be told
+    //    about these bytes again.
+    while (!conn.peer_closed) {
+        size_t used = conn.in.size();
+        conn.in.resize(used + CHUNK);
+        ssize_t n = read(conn.fd, &conn.in[used], CHUNK);
+        conn.in.resize(used + (n > 0 ? n : 0));
+
+        if (n > 0) {
+            if (conn.in.size() > MAX_REQUEST_SIZE) return IoStatus::TOO_LARGE;
+            continue;
+        }
+        if (n == 0) { conn.peer_closed = true; break; }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return IoStatus::CLOSED;
+    }
+
+    // 2. Do we have a whole request yet? Only the new bytes get looked at.
+    conn.read_pending = false;
+    return parse_buffered_request(conn);
+}
+
+IoStatus write_response(Connection& conn) {
+    // Headers and body go out as one scatter-gather write; nothing is
+    // concatenated, so a big rendered page is never copied again.
+    size_t total = conn.head.size() + conn.body.size();
+    while (conn.sent < total) {
+        iovec iov[2];
+        int count = 0;
+        if (conn.sent < conn.head.size()) {
+            iov[count++] = {conn.head.data() + conn.sent, conn.head.size() - conn.sent};
+            if (!conn.body.empty()) iov[count++] = {conn.body.data(), conn.body.size()};
+        } else {
+            size_t off = conn.sent - conn.head.size();
+            iov[count++] = {conn.body.data() + off, conn.body.size() - off};
+        }
+
+        ssize_t n = writev(conn.fd, iov, count);
+        if (n > 0) { conn.sent += n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return IoStatus::AGAIN;
+        return IoStatus::CLOSED;
+    }
+
+    // Static body: let the kernel copy it from the page cache to the socket.
+    // sendfile() keeps its own offset, so the shared fd's position is untouched.
+    while (conn.file && conn.file_sent < conn.file->size) {
+        ssize_t n = sendfile(conn.fd, conn.file->fd, &conn.file_sent, conn.file->size - conn.file_sent);
+        if (n > 0) continue;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return IoStatus::AGAIN;
+        // n == 0: the file shrank under us, we can't honour Content-Length
+        return IoStatus::CLOSED;
+    }
+    return IoStatus::DONE;
+}
+
+static void append_number(std::string& out, unsigned long long n) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), n);
+    out.append(buf, res.ptr - buf);
+}
+
+void format_response_head(const HttpResponse& res, bool keep_alive, const ServerConfig& cfg,
+                          std::string& out, bool chunked) {
+    out.append("HTTP/1.1 ").append(res.status).append("\r\n");
+    out.append("Content-Type: ").append(res.contentType).append("\r\n");
+    if (chunked) {
+        out.append("Transfer-Encoding: chunked\r\n");
+    } else {
+        out.append("Content-Length: ");
+        append_number(out, res.file ? size_t(res.file->size) : res.body.size());
+        out.append("\r\n");
+    }
+
+    if (keep_alive) {
+        out.append("Connection: keep-alive\r\nKeep-Alive: timeout=");
+        append_number(out, cfg.keepalive_timeout_sec);
+        out.append(", max=");
+        append_number(out, cfg.keepalive_max_requests);
+        out.append("\r\n");
+    } else {
+        out.append("Connection: close\r\n");
+    }
+
+    for (const auto& [key, val] : res.headers) {
+        out.append(key).append(": ").append(val).append("\r\n");
+    }
+
+    for (const auto& cookie : res.set_cookies) {
+        out.append("Set-Cookie: ").append(cookie).append("\r\n");
+    }
+
+    out.append("\r\n");
+}
+
+void Connection::setResponse(HttpResponse&& res, const ServerConfig& cfg) {
+    head.clear();
+    format_response_head(res, keep_alive, cfg, head);
+    body = std::move(res.body);
+    file = std::move(res.file);
+    sent = 0;
+    file_sent = 0;
+}
@@ -0,0 +1,152 @@
+#include "http_parser.hpp"
+#include <cctype>
+#include <cstring>
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+static std::string_view trim_view(std::string_view s) {
+    size_t first = s.find_first_not_of(" \t");
+    if (first == std::string_view::npos) return {};
+    size_t last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (size_t i = 0; i < headerCount; i++) {
+        if (iequals(headers[i].name, name)) return headers[i].value;
+    }
+    return {};
+}
+
+std::optional<std::string_view> HttpRequest::cookie(std::string_view name) const {
+    std::optional<std::string_view> found;
+    for (size_t i = 0; i < headerCount; i++) {
+        if (!iequals(headers[i].name, "Cookie")) continue;
+
+        // "a=1; b=2" -- the last occurrence wins, like a map insert would
+        std::string_view rest = headers[i].value;
+        while (!rest.empty()) {
+            size_t semi = rest.find(';');
+            std::string_view part = rest.substr(0, semi);
+            rest = semi == std::string_view::npos ? std::string_view() : rest.substr(semi + 1);
+
+            size_t eq = part.find('=');
+            if (eq == std::string_view::npos) continue;
+            std::string_view key = part.substr(0, eq);
+            std::string_view val = part.substr(eq + 1);
+            key.remove_prefix(std::min(key.find_first_not_of(' '), key.size()));
+            val.remove_prefix(std::min(val.find_first_not_of(' '), val.size()));
+            if (key == name) found = val;
+        }
+    }
+    return found;
+}
+
+HttpRequestParser::Result HttpRequestParser::parse(std::string_view buf) {
+    while (phase == Phase::REQUEST_LINE || phase == Phase::HEADERS) {
+        // 1. Find the end of the current line, resuming where we stopped
+        const void* nl = scan < buf.size() ? memchr(buf.data() + scan, '\n', buf.size() - scan) : nullptr;
+        if (!nl) {
+            scan = buf.size();
+            if (scan > MAX_HEADER_SIZE) return fail("431 Request Header Fields Too Large");
+            return Result::INCOMPLETE;
+        }
+
+        size_t end = static_cast<const char*>(nl) - buf.data();
+        std::string_view line = buf.substr(line_start, end - line_start);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        size_t off = line_start;
+        line_start = scan = end + 1;
+        // Complete lines count too, or many long ones would add up unchecked
+        if (line_start > MAX_HEADER_SIZE) return fail("431 Request Header Fields Too Large");
+
+        // 2. Request line, then headers until the blank line
+        if (phase == Phase::REQUEST_LINE) {
+            if (line.empty()) continue; // tolerate stray CRLFs between requests
+            if (!parseRequestLine(line, off)) return fail("400 Bad Request");
+            phase = Phase::HEADERS;
+        } else if (line.empty()) {
+            body_start = line_start;
+            phase = Phase::BODY;
+            if (content_length > MAX_REQUEST_SIZE) return fail("413 Payload Too Large");
+        } else if (!parseHeaderLine(line, off)) {
+            return Result::ERROR;
+        }
+    }
+
+    // 3. Body: just wait until Content-Length bytes are there
+    if (phase == Phase::BODY) {
+        if (buf.size() - body_start < content_length) return Result::INCOMPLETE;
+        phase = Phase::DONE;
+    }
+    return Result::COMPLETE;
+}
+
+bool HttpRequestParser::parseRequestLine(std::string_view line, size_t off) {
+    // "GET /profile HTTP/1.1"
+    size_t sp1 = line.find(' ');
+    if (sp1 == std::string_view::npos || sp1 == 0) return false;
+    size_t path_start = line.find_first_not_of(' ', sp1);
+    if (path_start == std::string_view::npos) return false;
+    size_t sp2 = line.find(' ', path_start);
+    size_t path_end = sp2 == std::string_view::npos ? line.size() : sp2;
+    size_t ver_start = sp2 == std::string_view::npos ? line.size() : line.find_first_not_of(' ', sp2);
+    if (ver_start == std::string_view::npos) ver_start = line.size();
+
+    method = {uint32_t(off), uint32_t(sp1)};
+    path = {uint32_t(off + path_start), uint32_t(path_end - path_start)};
+    version = {uint32_t(off + ver_start), uint32_t(line.size() - ver_start)};
+    return true;
+}
+
+bool HttpRequestParser::parseHeaderLine(std::string_view line, size_t off) {
+    size_t colon = line.find(':');
+    // Not a header. Skipping it would also let it slip past header_count.
+    if (colon == std::string_view::npos || colon == 0) return reject("400 Bad Request");
+    if (header_count == MAX_HEADERS) return reject("431 Request Header Fields Too Large");
+
+    std::string_view name = line.substr(0, colon);
+    std::string_view value = trim_view(line.substr(colon + 1));
+    size_t value_off = value.empty() ? off + line.size() : off + (value.data() - line.data());
+
+    header_names[header_count] = {uint32_t(off), uint32_t(name.size())};
+    header_values[header_count] = {uint32_t(value_off), uint32_t(value.size())};
+    header_count++;
+
+    // Framing: only a single Content-Length is understood. With chunked
+    // bodies or two lengths, we and a proxy in front of us could disagree
+    // on where this request ends, and the rest would be run as the next
+    // pipelined request.
+    if (iequals(name, "Transfer-Encoding")) return reject("501 Not Implemented");
+    if (iequals(name, "Content-Length")) {
+        if (has_length) return reject("400 Bad Request");
+        has_length = true;
+        // Digits only: "5x" or "" read as some number would misframe the body.
+        // Past MAX_REQUEST_SIZE it stops counting and is answered 413.
+        if (value.empty()) return reject("400 Bad Request");
+        size_t n = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') return reject("400 Bad Request");
+            if (n <= MAX_REQUEST_SIZE) n = n * 10 + (c - '0');
+        }
+        content_length = n;
+    }
+    return true;
+}
+
+void HttpRequestParser::fill(HttpRequest& req, const char* base) const {
+    req.method = method.in(base);
+    req.path = path.in(base);
+    req.version = version.in(base);
+    req.body = std::string_view(base + body_start, content_length);
+    req.headerCount = header_count;
+    for (size_t i = 0; i < header_count; i++) {
+        req.headers[i] = {header_names[i].in(base), header_values[i].in(base)};
+    }
+}
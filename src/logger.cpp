@@ -0,0 +1,167 @@
+#include "logger.hpp"
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+std::atomic<LogLevel> Logger::threshold{LogLevel::DEBUG};
+
+struct LogRecord {
+    LogLevel level;
+    std::time_t time;
+    std::string text;
+};
+
+// Lines from one thread on their way to the writer. Only the owning
+// thread pushes and only the writer pops, so head and tail are all the
+// synchronization it needs.
+struct LogRing {
+    static constexpr size_t CAPACITY = 4096; // power of two
+
+    std::array<LogRecord, CAPACITY> slots;
+    alignas(64) std::atomic<size_t> head{0}; // next to write out (writer)
+    alignas(64) std::atomic<size_t> tail{0}; // next free slot (owner)
+    std::atomic<size_t> dropped{0};
+
+    void push(LogLevel level, std::time_t time, std::string& text) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        LogRecord& r = slots[t & (CAPACITY - 1)];
+        r.level = level;
+        r.time = time;
+        r.text.swap(text);
+        tail.store(t + 1, std::memory_order_release);
+    }
+};
+
+struct LogWriter {
+    std::mutex mtx; // guards everything below; held by registration and drain()
+    std::vector<std::shared_ptr<LogRing>> rings;
+    std::string out;
+
+    // strftime() runs once per second of log lines, not once per line
+    std::time_t stampSecond = -1;
+    char stamp[20] = {};
+};
+
+static const char* label(LogLevel level) {
+    switch (level) {
+        case LogLevel::INFO:  return "\033[32m[INFO]\033[0m ";  // Green
+        case LogLevel::WARN:  return "\033[33m[WARN]\033[0m ";  // Yellow
+        case LogLevel::ERR:   return "\033[31m[FAIL]\033[0m ";  // Red
+        case LogLevel::DEBUG: return "\033[36m[DEBG]\033[0m ";  // Cyan
+    }
+    return "";
+}
+
+static void append(LogWriter& w, LogLevel level, std::time_t time, const std::string& text) {
+    if (time != w.stampSecond) {
+        std::tm tm;
+        localtime_r(&time, &tm);
+        std::strftime(w.stamp, sizeof(w.stamp), "%Y-%m-%d %H:%M:%S", &tm);
+        w.stampSecond = time;
+    }
+    w.out += '[';
+    w.out += w.stamp;
+    w.out += "] ";
+    w.out += label(level);
+    w.out += text;
+    w.out += '\n';
+}
+
+// Moves every queued line to stdout; returns how many there were
+static size_t drain(LogWriter& w) {
+    std::lock_guard<std::mutex> lock(w.mtx);
+    size_t lines = 0;
+
+    for (size_t i = 0; i < w.rings.size();) {
+        LogRing& ring = *w.rings[i];
+        size_t h = ring.head.load(std::memory_order_relaxed);
+        size_t t = ring.tail.load(std::memory_order_acquire);
+        for (; h != t; h++) {
+            LogRecord& r = ring.slots[h & (LogRing::CAPACITY - 1)];
+            append(w, r.level, r.time, r.text);
+            std::string().swap(r.text);
+            lines++;
+        }
+        ring.head.store(h, std::memory_order_release);
+
+        if (size_t lost = ring.dropped.exchange(0, std::memory_order_relaxed)) {
+            append(w, LogLevel::WARN, std::time(nullptr),
+                   "Logger: dropped " + std::to_string(lost) + " lines from a thread that outran the writer");
+        }
+
+        // The owning thread has exited and everything it logged is out
+        if (w.rings[i].use_count() == 1) {
+            w.rings[i] = std::move(w.rings.back());
+            w.rings.pop_back();
+        } else {
+            i++;
+        }
+    }
+
+    if (!w.out.empty()) {
+        std::fwrite(w.out.data(), 1, w.out.size(), stdout);
+        std::fflush(stdout);
+        w.out.clear();
+    }
+    return lines;
+}
+
+static void run_writer(LogWriter* w) {
+    for (;;) {
+        // Poll instead of waking on every line: producers then never
+        // make a syscall, and a line waits at most one nap
+        size_t lines = drain(*w);
+        std::this_thread::sleep_for(std::chrono::milliseconds(lines ? 5 : 50));
+    }
+}
+
+// Never destroyed: worker threads may still log while statics go away
+static LogWriter& writer() {
+    static LogWriter* w = [] {
+        auto* w = new LogWriter;
+
+        // Keep signals off the writer, whatever the caller has unblocked
+        // (SIGHUP must reach the config watcher's signalfd, not kill us here)
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        std::thread(run_writer, w).detach();
+        pthread_sigmask(SIG_SETMASK, &old, nullptr);
+
+        std::atexit(Logger::flush);
+        return w;
+    }();
+    return *w;
+}
+
+static LogRing& local_ring() {
+    thread_local std::shared_ptr<LogRing> ring = [] {
+        auto r = std::make_shared<LogRing>();
+        LogWriter& w = writer();
+        std::lock_guard<std::mutex> lock(w.mtx);
+        w.rings.push_back(r);
+        return r;
+    }();
+    return *ring;
+}
+
+void Logger::log(LogLevel level, std::string message) {
+    if (!enabled(level)) return;
+    local_ring().push(level, std::time(nullptr), message);
+}
+
+void Logger::flush() {
+    drain(writer());
+}
@@ -2,51 +2,88 @@
 #include "script_lexer.hpp"
 #include "script_parser.hpp"
 #include "logic_engine.hpp"
+#include "script_optimizer.hpp"
+#include "script_profiler.hpp"
+#include "script_vm.hpp"
+#include "file_cache.hpp"
 #include "logger.hpp"
-#include <fstream>
-#include <sstream>
-
-void ScriptExecutor::execute(const std::string& path, const HttpRequest& req, HttpResponse& res) {
-    Logger::log(LogLevel::INFO, "Executor: Loading " + path);
-
-    // 1. Read the script file into a string
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        Logger::log(LogLevel::ERR, "Executor: Could not open file " + path);
-        res.status = "404 Not Found";
-        return;
-    }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string source = buffer.str();
-
-    // 2. Prepare the Execution Context
-    // This holds variables, form data, and references to req/res
-    ScriptContext ctx{req, res};
-    
-    // If it's a POST, we assume form-encoded data for this example
-    if (req.method == "POST") {
-        ctx.form = Parser::parseForm(req.body); 
-    }
+
+ScriptEngine ScriptExecutor::engine = ScriptEngine::VM;
+
+// A script ready to run: the tree, its variables' names by slot, and the
+// bytecode compiled from it
+struct CompiledScript {
+    std::unique_ptr<ASTNode> ast;
+    std::vector<std::string> locals;
+    Bytecode code;
+};
+
+// Compiled scripts by path. Neither form is modified while running, so
+// one copy serves every worker thread at once.
+static FileCache<CompiledScript> programs([](const std::string& path, const std::string& source) {
+    auto script = std::make_shared<CompiledScript>();
+
+    // Tokenize (The Lexer), Parse (The Pratt Parser), Optimize, Resolve, then Compile
+    ScriptLexer lexer(source);
+    ScriptParser parser(lexer.tokenize());
+    script->ast = parser.parseProgram();
+    size_t removed = ScriptOptimizer::optimize(script->ast);
+    script->locals = ScriptResolver::resolve(*script->ast);
+    script->code = ScriptCompiler::compile(*script->ast);
+
+    LOG(LogLevel::INFO, "Executor: Compiled " + path + " (optimizer removed " + std::to_string(removed) +
+                " of " + std::to_string(removed + script->ast->nodeCount()) + " nodes; " +
+                std::to_string(script->code.code.size()) + " instructions, " +
+                std::to_string(script->code.registers) + " registers)");
+    return std::shared_ptr<const CompiledScript>(std::move(script));
+});
+
+void ScriptExecutor::execute(const std::string& path, const HttpRequest& req, HttpResponse& res,
+                             const RouteParams& params) {
+    LOG(LogLevel::INFO, "Executor: Loading " + path);
 
     try {
-        // 3. Tokenize (The Lexer)
-        ScriptLexer lexer(source);
-        std::vector<Token> tokens = lexer.tokenize();
+        // 1. Fetch the parsed program; the file is only read and parsed
+        // again when it changes on disk
+        std::shared_ptr<const CompiledScript> program = programs.get(path);
+        if (!program) {
+            LOG(LogLevel::ERR, "Executor: Could not open file " + path);
+            res.status = "404 Not Found";
+            return;
+        }
+
+        // 2. Prepare the Execution Context
+        // This holds variables, form data, and references to req/res
+        ScriptContext ctx(req, res);
+        ctx.locals.resize(program->locals.size());
+        ctx.localNames = &program->locals;
 
-        // 4. Parse (The Pratt Parser)
-        ScriptParser parser(tokens);
-        std::unique_ptr<ASTNode> program = parser.parseProgram();
+        // If it's a POST, we assume form-encoded data for this example
+        if (req.method == "POST") {
+            ctx.form = Parser::parseForm(std::string(req.body));
+        }
+        for (size_t i = 0; i < params.count; i++) {
+            ctx.params[std::string(params.items[i].name)] = std::string(params.items[i].value);
+        }
 
-        // 5. Execute (The AST traversal)
-        Logger::log(LogLevel::INFO, "Executor: Running AST...");
-        program->reduce(ctx);
-        Logger::log(LogLevel::INFO, "Executor: Success.");
+        // 3. Execute (bytecode, or the AST traversal). Profiling times
+        // every node, which only the tree has, so it runs the tree.
+        if (ScriptProfiler::enabled()) {
+            LOG(LogLevel::INFO, "Executor: Running AST (profiling)...");
+            ScriptProfiler::Scope scope(path);
+            program->ast->reduce(ctx);
+        } else if (engine == ScriptEngine::VM) {
+            LOG(LogLevel::INFO, "Executor: Running bytecode...");
+            ScriptVM::run(program->code, ctx);
+        } else {
+            LOG(LogLevel::INFO, "Executor: Running AST...");
+            program->ast->reduce(ctx);
+        }
+        LOG(LogLevel::INFO, "Executor: Success.");
 
     } catch (const std::exception& e) {
-        Logger::log(LogLevel::ERR, "Script Runtime Error: " + std::string(e.what()));
+        LOG(LogLevel::ERR, "Script Runtime Error: " + std::string(e.what()));
         res.status = "500 Internal Server Error";
         res.body = "Script Error: " + std::string(e.what());
     }
-}
\ No newline at end of file
+}
@@ -11,6 +11,13 @@ std::string trim(const std::string& s) {
     return s.substr(first, (last - first + 1));
 }
 
+std::string_view trim(std::string_view s) {
+    size_t first = s.find_first_not_of(" \t\n\r");
+    if (std::string_view::npos == first) return {};
+    size_t last = s.find_last_not_of(" \t\n\r");
+    return s.substr(first, (last - first + 1));
+}
+
 
 std::string Parser::urlDecode(const std::string& str) {
     std::string res;
@@ -0,0 +1,77 @@
+#include "response_stream.hpp"
+#include "http.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <poll.h>
+#include <sys/uio.h>
+
+void ResponseStream::begin(const HttpResponse& res) {
+    std::string head;
+    format_response_head(res, keep_alive, cfg, head, true);
+    iovec iov{head.data(), head.size()};
+    sendAll(&iov, 1);
+    began = true;
+    sentStatus = res.status;
+    buffer.reserve(CHUNK_SIZE);
+    flushAt = CHUNK_SIZE;
+}
+
+void ResponseStream::finish() {
+    if (!began || finished) return;
+    finished = true;
+    flush();
+    static const char last[] = "0\r\n\r\n";
+    iovec iov{const_cast<char*>(last), sizeof(last) - 1};
+    sendAll(&iov, 1);
+}
+
+void ResponseStream::flush() {
+    if (broken) buffer.clear();
+    if (buffer.empty()) return;
+
+    // <size in hex>\r\n<data>\r\n, framed around the buffer without copying it
+    char size_line[20];
+    int len = snprintf(size_line, sizeof(size_line), "%zx\r\n", buffer.size());
+    iovec iov[3] = {
+        {size_line, size_t(len)},
+        {buffer.data(), buffer.size()},
+        {const_cast<char*>("\r\n"), 2},
+    };
+    sendAll(iov, 3);
+    buffer.clear();
+}
+
+bool ResponseStream::sendAll(const iovec* src, int count) {
+    if (broken) return false;
+
+    iovec iov[3];
+    for (int i = 0; i < count; i++) iov[i] = src[i];
+    iovec* cur = iov;
+
+    while (count > 0) {
+        ssize_t n = writev(fd, cur, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pollfd pfd{fd, POLLOUT, 0};
+                if (poll(&pfd, 1, cfg.write_timeout_sec * 1000) > 0) continue;
+                LOG(LogLevel::WARN, "Stream: client too slow, giving up");
+            }
+            broken = true;
+            return false;
+        }
+
+        // Skip whatever was fully written, trim the partly written one
+        while (count > 0 && size_t(n) >= cur->iov_len) {
+            n -= cur->iov_len;
+            cur++;
+            count--;
+        }
+        if (count > 0) {
+            cur->iov_base = static_cast<char*>(cur->iov_base) + n;
+            cur->iov_len -= n;
+        }
+    }
+    return true;
+}
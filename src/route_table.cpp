@@ -0,0 +1,158 @@
+#include "route_table.hpp"
+#include "router.hpp"
+#include "logger.hpp"
+
+// Compressed radix tree. Literal children are keyed by their first byte
+// (at most one child per byte); a `:param` child matches one whole segment.
+struct RouteTable::Node {
+    std::string prefix;
+    std::vector<std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> param;
+    std::string paramName;
+    const RouteConfig* route = nullptr;
+};
+
+RouteTable::RouteTable() = default;
+RouteTable::~RouteTable() = default;
+RouteTable::RouteTable(RouteTable&&) noexcept = default;
+RouteTable& RouteTable::operator=(RouteTable&&) noexcept = default;
+
+static const std::string_view GROUP_NAMES[] = {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9"};
+
+// A tree pattern is a path with no regex syntax in it except optional
+// ^...$ anchors, which regex_match implied anyway.
+static bool tree_pattern(std::string_view pattern, std::string_view& out) {
+    if (!pattern.empty() && pattern.front() == '^') pattern.remove_prefix(1);
+    if (!pattern.empty() && pattern.back() == '$') pattern.remove_suffix(1);
+    if (pattern.empty() || pattern.front() != '/') return false;
+    if (pattern.find_first_of(".[](){}*+?|\\^$") != std::string_view::npos) return false;
+    out = pattern;
+    return true;
+}
+
+RouteTable::Node* RouteTable::insertLiteral(Node* node, std::string_view literal) {
+    while (!literal.empty()) {
+        Node* next = nullptr;
+        for (auto& child : node->children) {
+            if (child->prefix[0] == literal[0]) { next = child.get(); break; }
+        }
+
+        if (!next) {
+            auto leaf = std::make_unique<Node>();
+            leaf->prefix = std::string(literal);
+            node->children.push_back(std::move(leaf));
+            return node->children.back().get();
+        }
+
+        // Split the child where it stops agreeing with us
+        size_t common = 0;
+        while (common < next->prefix.size() && common < literal.size() &&
+               next->prefix[common] == literal[common]) common++;
+
+        if (common < next->prefix.size()) {
+            auto tail = std::make_unique<Node>();
+            tail->prefix = next->prefix.substr(common);
+            tail->children = std::move(next->children);
+            tail->param = std::move(next->param);
+            tail->paramName = std::move(next->paramName);
+            tail->route = next->route;
+
+            next->prefix.resize(common);
+            next->children.clear();
+            next->children.push_back(std::move(tail));
+            next->paramName.clear();
+            next->route = nullptr;
+        }
+        node = next;
+        literal.remove_prefix(common);
+    }
+    return node;
+}
+
+void RouteTable::add(const RouteConfig& config) {
+    routes.push_back(std::make_unique<RouteConfig>(config));
+    const RouteConfig* route = routes.back().get();
+
+    std::string_view pattern;
+    if (!tree_pattern(route->pathRegex, pattern)) {
+        regexRoutes.push_back({route->method, std::regex(route->pathRegex, std::regex::optimize),
+                               routes.size() - 1});
+        return;
+    }
+
+    std::unique_ptr<Node>& root = trees[route->method];
+    if (!root) root = std::make_unique<Node>();
+
+    // Walk "/users/:id/posts" as literal "/users/", param "id", literal "/posts"
+    Node* node = root.get();
+    while (!pattern.empty()) {
+        size_t colon = pattern.find("/:");
+        if (colon == std::string_view::npos) {
+            node = insertLiteral(node, pattern);
+            break;
+        }
+        node = insertLiteral(node, pattern.substr(0, colon + 1));
+        pattern.remove_prefix(colon + 2);
+
+        size_t end = pattern.find('/');
+        std::string_view name = pattern.substr(0, end);
+        if (!node->param) {
+            node->param = std::make_unique<Node>();
+            node->paramName = std::string(name);
+        } else if (node->paramName != name) {
+            LOG(LogLevel::WARN, "Route " + route->pathRegex + ": parameter :" + std::string(name) +
+                        " is already called :" + node->paramName + " here");
+        }
+        node = node->param.get();
+        pattern.remove_prefix(name.size());
+    }
+
+    if (node->route) {
+        LOG(LogLevel::WARN, "Duplicate route " + route->method + " " + route->pathRegex + " ignored");
+        return;
+    }
+    node->route = route;
+}
+
+// Literal children first, then the param child; backtracks if a branch dead-ends
+const RouteConfig* RouteTable::matchNode(const Node& node, std::string_view path, RouteParams& params) {
+    if (path.empty()) return node.route;
+
+    for (const auto& child : node.children) {
+        if (child->prefix[0] != path[0]) continue;
+        if (path.compare(0, child->prefix.size(), child->prefix) == 0) {
+            if (auto* route = matchNode(*child, path.substr(child->prefix.size()), params)) return route;
+        }
+        break;
+    }
+
+    if (node.param && params.count < MAX_ROUTE_PARAMS) {
+        size_t end = path.find('/');
+        std::string_view segment = path.substr(0, end);
+        if (!segment.empty()) {
+            params.items[params.count++] = {node.paramName, segment};
+            if (auto* route = matchNode(*node.param, path.substr(segment.size()), params)) return route;
+            params.count--;
+        }
+    }
+    return nullptr;
+}
+
+const RouteConfig* RouteTable::match(std::string_view method, std::string_view path, RouteParams& params) const {
+    params.count = 0;
+
+    auto tree = trees.find(method);
+    if (tree != trees.end()) {
+        if (auto* route = matchNode(*tree->second, path, params)) return route;
+    }
+
+    for (const auto& r : regexRoutes) {
+        std::cmatch groups;
+        if (r.method != method || !std::regex_match(path.data(), path.data() + path.size(), groups, r.pattern)) continue;
+        for (size_t i = 1; i < groups.size() && i < std::size(GROUP_NAMES) && params.count < MAX_ROUTE_PARAMS; i++) {
+            params.items[params.count++] = {GROUP_NAMES[i], std::string_view(groups[i].first, groups[i].length())};
+        }
+        return routes[r.route].get();
+    }
+    return nullptr;
+}
@@ -3,47 +3,85 @@
 #include "logger.hpp"
 #include "session_store.hpp"
 #include "script_executor.hpp"
+#include "static_files.hpp"
 #include <fstream>
-#include <iostream>
 
-std::vector<RouteConfig> Router::configRoutes;
+std::shared_ptr<const RouteTable> Router::routeTable;
+std::atomic<uint64_t> Router::generation{0};
 std::map<std::string, std::string> SessionStore::sessions;
+std::mutex SessionStore::mtx;
 std::mutex Router::router_mutex;
 
 void Router::loadConfig() {
+    // One writer at a time (startup, SIGHUP and the file watcher)
     std::lock_guard<std::mutex> lock(router_mutex);
-    configRoutes.clear();
+
     std::ifstream file("service/routes.conf");
+    if (!file.is_open()) {
+        LOG(LogLevel::ERR, "Could not open service/routes.conf");
+        if (routeTable) return;
+    }
+
+    auto table = std::make_shared<RouteTable>();
     std::string line;
     while (std::getline(file, line)) {
         std::stringstream ss(line);
-        std::string m, p, s;
+        std::string m, p, s, opts;
         if (std::getline(ss, m, '|') && std::getline(ss, p, '|') && std::getline(ss, s, '|')) {
-            configRoutes.push_back({trim(m), trim(p), trim(s)});
+            RouteConfig route{trim(m), trim(p), trim(s)};
+            // e.g. "GET | ^/list$ | service/list.script | stream"
+            if (std::getline(ss, opts, '|')) route.stream = trim(opts) == "stream";
+            try {
+                table->add(route);
+            } catch (const std::regex_error& e) {
+                LOG(LogLevel::ERR, "Bad route pattern " + route.pathRegex + ": " + e.what());
+            }
         }
     }
+
+    // Publish the table first, then bump the generation so readers fetch it
+    std::atomic_store(&routeTable, std::shared_ptr<const RouteTable>(std::move(table)));
+    generation.fetch_add(1, std::memory_order_release);
+    LOG(LogLevel::INFO, "Loaded " + std::to_string(routeTable->size()) + " routes");
+}
+
+std::shared_ptr<const RouteTable> Router::routes() {
+    thread_local uint64_t seen = 0;
+    thread_local std::shared_ptr<const RouteTable> cached;
+
+    uint64_t current = generation.load(std::memory_order_acquire);
+    if (current != seen) {
+        cached = std::atomic_load(&routeTable);
+        seen = current;
+    }
+    return cached;
 }
 
-HttpResponse Router::handleRequest(HttpRequest& req) {
-    Logger::log(LogLevel::INFO, req.method + " " + req.path);
+HttpResponse Router::handleRequest(HttpRequest& req, ResponseStream* stream) {
+    std::string path(req.path);
+    LOG(LogLevel::INFO, std::string(req.method) + " " + path);
 
-    if (!req.cookies.empty()) Logger::log(LogLevel::DEBUG, "Session Cookie found: " + req.cookies["sid"]);
+    if (auto sid = req.cookie("sid")) LOG(LogLevel::DEBUG, "Session Cookie found: " + std::string(*sid));
 
       if (req.path.rfind("/static/", 0) == 0) { // starts with /static/
         HttpResponse res;
-        res.body = readFile(req.path);
-        res.contentType = getMimeType(req.path);
-        Logger::log(LogLevel::INFO, "Serving static file: " + req.path);
+        res.file = StaticFileCache::open(path);
+        if (!res.file) return HttpResponse::html("404 Not Found", "404 Not Found");
+        res.contentType = res.file->mimeType;
+        LOG(LogLevel::INFO, "Serving static file: " + path);
         return res;
       }
 
-    for (auto& route : configRoutes) {
-        std::cout << "Checking against: " << route.method << " " << route.pathRegex << "\n";
-        if (req.method == route.method && std::regex_match(req.path, std::regex(route.pathRegex))) {
-            HttpResponse res;
-            ScriptExecutor::execute(route.scriptPath, req, res);
-            return res;
-        }
+    // Held for the whole request, so a reload meanwhile can't free it
+    std::shared_ptr<const RouteTable> table = routes();
+    RouteParams params;
+    const RouteConfig* route = table ? table->match(req.method, req.path, params) : nullptr;
+    if (route) {
+        HttpResponse res;
+        // Chunked framing is HTTP/1.1; older clients get the page buffered
+        if (route->stream && req.version == "HTTP/1.1") res.stream = stream;
+        ScriptExecutor::execute(route->scriptPath, req, res, params);
+        return res;
     }
     return HttpResponse::html("404 Not Found", "404 Not Found");
 }
@@ -65,18 +103,6 @@ std::string Router::getMimeType(const std::string& path) {
     return "text/plain";
 }
 
-std::string Router::readFile(const std::string& path) {
-    // Basic security: don't allow ".." to escape the service folder
-    if (path.find("..") != std::string::npos) return "";
-
-    std::ifstream f("service" + path);
-    if (!f.is_open()) return "";
-    
-    std::stringstream b; 
-    b << f.rdbuf();
-    return b.str();
-}
-
 void Router::saveSession(std::string sid, std::string user) {
     std::lock_guard<std::mutex> lock(router_mutex);
     SessionStore::save(sid, user);
@@ -2,60 +2,84 @@
 #include "logic_engine.hpp" 
 #include "session_store.hpp"
 #include "logger.hpp"
+#include "response_stream.hpp"
 #include <iostream>
+#include <optional>
+
+// The parser leaves a child empty where a script stops short ("1 +",
+// "if" with no condition). That reads as false, the same value the
+// compiler loads for it (ScriptCompiler::expression).
+static Value eval_or_empty(const std::unique_ptr<ASTNode>& node, ScriptContext& ctx) {
+    return node ? node->eval(ctx) : Value();
+}
 
 // --- Expressions ---
 
-Value VariableExpr::reduce(ScriptContext& ctx) {
-    // 1. Handle form.variable
-    if (varName.rfind("form.", 0) == 0) {
-        std::string key = varName.substr(5);
-        Logger::log(LogLevel::DEBUG, "[AST] Looking up form data: " + key);
-        return ctx.form.count(key) ? Value(ctx.form.at(key)) : Value("");
-    }
+Value VariableExpr::reduce(ScriptContext& ctx) const {
+    return lookup_variable(ctx, ref);
+}
 
-    // 2. Handle session.variable
-    if (varName.rfind("session.", 0) == 0) {
-        std::string key = varName.substr(8);
-        std::string sid = ctx.req.cookies.count(key) ? ctx.req.cookies.at(key) : "";
-        if (sid.empty()) {
-            Logger::log(LogLevel::WARN, "[AST] Session lookup failed: No 'sid' cookie found");
-            return Value("");
+Value lookup_variable(ScriptContext& ctx, const VarRef& ref) {
+    const std::string& key = ref.key;
+    switch (ref.scope) {
+        // 1. Handle form.variable
+        case VarScope::FORM: {
+            LOG(LogLevel::DEBUG, "[AST] Looking up form data: " + key);
+            auto it = ctx.form.find(key);
+            return it != ctx.form.end() ? Value(it->second) : Value("");
         }
-        std::string sessionData = SessionStore::get(sid);
-        Logger::log(LogLevel::DEBUG, "[AST] Session retrieved for SID: " + sid);
-        return Value(sessionData);
-    }
 
-    // 3. Handle cookie.variable
-    if (varName.rfind("cookie.", 0) == 0) {
-        std::string key = varName.substr(7);
-        Logger::log(LogLevel::DEBUG, "[AST] Looking up cookie: " + key);
-        return ctx.req.cookies.count(key) ? Value(ctx.req.cookies.at(key)) : Value("");
-    }
+        // 2. Handle session.variable
+        case VarScope::SESSION: {
+            std::string sid(ctx.req.cookie(key).value_or(""));
+            if (sid.empty()) {
+                LOG(LogLevel::WARN, "[AST] Session lookup failed: No 'sid' cookie found");
+                return Value("");
+            }
+            std::string sessionData = SessionStore::get(sid);
+            LOG(LogLevel::DEBUG, "[AST] Session retrieved for SID: " + sid);
+            return Value(sessionData);
+        }
 
-    // 4. Fallback to local script variables
-    if (ctx.vars.count(varName)) {
-        return ctx.vars.at(varName);
-    }
+        // 3. Handle cookie.variable
+        case VarScope::COOKIE: {
+            LOG(LogLevel::DEBUG, "[AST] Looking up cookie: " + key);
+            auto cookie = ctx.req.cookie(key);
+            return cookie ? Value(std::string(*cookie)) : Value("");
+        }
 
-    Logger::log(LogLevel::DEBUG, "[AST] Variable not found, returning empty: " + varName);
+        // 4. Handle param.variable (captured from the route pattern)
+        case VarScope::PARAM: {
+            LOG(LogLevel::DEBUG, "[AST] Looking up path param: " + key);
+            auto it = ctx.params.find(key);
+            return it != ctx.params.end() ? Value(it->second) : Value("");
+        }
+
+        // 5. Fallback to local script variables
+        case VarScope::LOCAL:
+            if (ctx.locals[ref.slot]) return *ctx.locals[ref.slot];
+            LOG(LogLevel::DEBUG, "[AST] Variable not found, returning empty: " + (*ctx.localNames)[ref.slot]);
+            break;
+    }
     return Value(""); 
 }
 
-Value BinaryExpr::reduce(ScriptContext& ctx) {
-    Value leftVal = left->reduce(ctx);
-    Value rightVal = right->reduce(ctx);
+Value BinaryExpr::reduce(ScriptContext& ctx) const {
+    Value leftVal = eval_or_empty(left, ctx);
+    Value rightVal = eval_or_empty(right, ctx);
 
-    Logger::log(LogLevel::DEBUG, "[AST] Binary Op: " + leftVal.asString() + " [Op] " + rightVal.asString());
+    LOG(LogLevel::DEBUG, "[AST] Binary Op: " + leftVal.asString() + " [Op] " + rightVal.asString());
+    return apply_binary(op, leftVal, rightVal);
+}
 
+Value apply_binary(TokenType op, const Value& leftVal, const Value& rightVal) {
     switch (op) {
         case TokenType::PLUS:          return leftVal.asInt() + rightVal.asInt();
         case TokenType::MINUS:         return leftVal.asInt() - rightVal.asInt();
         case TokenType::STAR:          return leftVal.asInt() * rightVal.asInt();
         case TokenType::SLASH: {
             if (rightVal.asInt() == 0) {
-                Logger::log(LogLevel::ERR, "[AST] Runtime Error: Division by zero");
+                LOG(LogLevel::ERR, "[AST] Runtime Error: Division by zero");
                 return Value(0);
             }
             return leftVal.asInt() / rightVal.asInt();
@@ -70,123 +94,159 @@ Value BinaryExpr::reduce(ScriptContext& ctx) {
 
 // --- Statements ---
 
-Value BlockStmt::reduce(ScriptContext& ctx) {
+Value BlockStmt::reduce(ScriptContext& ctx) const {
     Value last;
     for (auto& s : statements) {
         if (s) { // The Shield: prevent segfault if parser messed up
-            last = s->reduce(ctx);
+            last = s->eval(ctx);
         }
         // Optimization: If a redirect was triggered, stop executing the rest of the script
-        if (ctx.res.status == "302 Found") return last;
+        if (ctx.redirected) return last;
     }
     return last;
 }
-Value AssignmentStmt::reduce(ScriptContext& ctx) {
-    Value val = expression->reduce(ctx);
-    Logger::log(LogLevel::INFO, "[AST] Assign: " + varName + " = " + val.asString());
-    ctx.vars[varName] = val;
+Value AssignmentStmt::reduce(ScriptContext& ctx) const {
+    if (!expression) {
+        // "set x =" with nothing after it: x becomes false, as in the VM
+        LOG(LogLevel::ERR, "[AST] set " + varName + ": missing expression");
+        ctx.locals[slot] = Value();
+        return Value();
+    }
+    Value val = expression->eval(ctx);
+    LOG(LogLevel::INFO, "[AST] Assign: " + varName + " = " + val.asString());
+    ctx.locals[slot] = std::move(val);
     return Value();
 }
 
-Value IfStmt::reduce(ScriptContext& ctx) {
-    Value condResult = condition->reduce(ctx);
+Value IfStmt::reduce(ScriptContext& ctx) const {
+    Value condResult = eval_or_empty(condition, ctx);
     
     if (condResult.isTruthy()) {
-        Logger::log(LogLevel::DEBUG, "[AST] If condition TRUE, entering 'then' branch");
-        return thenBranch->reduce(ctx);
+        LOG(LogLevel::DEBUG, "[AST] If condition TRUE, entering 'then' branch");
+        return eval_or_empty(thenBranch, ctx);
     } else if (elseBranch) {
-        Logger::log(LogLevel::DEBUG, "[AST] If condition FALSE, entering 'else' branch");
-        return elseBranch->reduce(ctx);
+        LOG(LogLevel::DEBUG, "[AST] If condition FALSE, entering 'else' branch");
+        return elseBranch->eval(ctx);
     }
     return {};
 }
 
-Value CommandStmt::reduce(ScriptContext& ctx) {
-    if (command == "render") {
-        if (arguments.empty()) return {};
-        std::string templatePath = arguments[0]->reduce(ctx).asString();
-        
-        Logger::log(LogLevel::INFO, "[AST] Rendering template: " + templatePath);
-        
-        RenderContext t_ctx;
-        t_ctx.vars = ctx.vars; 
-
-        std::string rawHtml = Router::readFile("/" + templatePath);
-        ctx.res.body = Template::render(rawHtml, t_ctx);
-        ctx.res.status = "200 OK";
-        ctx.res.headers["Content-Type"] = "text/html";
-        return {};
-    } 
-    else if (command == "save_session") {
-        if (arguments.size() < 2) {
-             Logger::log(LogLevel::ERR, "[AST] save_session: missing arguments");
-             return {};
-        }
-        std::string sid = arguments[0]->reduce(ctx).asString();
-        std::string user = arguments[1]->reduce(ctx).asString();
-        
-        Logger::log(LogLevel::INFO, "[AST] Saving session for user: " + user);
-        SessionStore::save(sid, user);
-        return {};
-    }
-    else if (command == "add_cookie") {
-        std::string key = arguments[0]->reduce(ctx).asString(); 
-        std::string val = arguments[1]->reduce(ctx).asString();
-        
-        Logger::log(LogLevel::INFO, "[AST] Setting cookie: " + key + "=" + val);
-        ctx.res.add_cookie(key, val);
-        return {};
+std::string CommandStmt::argString(ScriptContext& ctx, size_t i) const {
+    const ASTNode* node = arg(i);
+    return node ? node->eval(ctx).asString() : Value().asString();
+}
+
+Value RenderStmt::reduce(ScriptContext& ctx) const {
+    if (arguments.empty()) return {};
+    command_render(ctx, argString(ctx, 0));
+    return {};
+}
+
+Value SaveSessionStmt::reduce(ScriptContext& ctx) const {
+    if (arguments.size() < 2) {
+         LOG(LogLevel::ERR, "[AST] save_session: missing arguments");
+         return {};
     }
-    else if (command == "redirect") {
-        if (arguments.empty()) {
-            Logger::log(LogLevel::ERR, "[AST] Redirect command missing URL");
-            return {};
-        }
-        std::string url = arguments[0]->reduce(ctx).asString();
-        Logger::log(LogLevel::INFO, "[AST] Redirecting to: " + url);
-        ctx.res.status = "302 Found";
-        ctx.res.headers["Location"] = url;
-        ctx.res.body = ""; 
+    std::string sid = argString(ctx, 0);
+    std::string user = argString(ctx, 1);
+    command_save_session(ctx, sid, user);
+    return {};
+}
+
+Value AddCookieStmt::reduce(ScriptContext& ctx) const {
+    std::string key = argString(ctx, 0);
+    std::string val = argString(ctx, 1);
+    command_add_cookie(ctx, key, val);
+    return {};
+}
+
+Value RedirectStmt::reduce(ScriptContext& ctx) const {
+    if (arguments.empty()) {
+        LOG(LogLevel::ERR, "[AST] Redirect command missing URL");
         return {};
     }
+    command_redirect(ctx, argString(ctx, 0));
     return {};
 }
 
-Value ForStmt::reduce(ScriptContext& ctx) {
+void command_render(ScriptContext& ctx, const std::string& templatePath) {
+    LOG(LogLevel::INFO, "[AST] Rendering template: " + templatePath);
+    std::optional<ScriptProfiler::Scope> timing;
+    if (ScriptProfiler::enabled()) timing.emplace("template " + templatePath);
+
+    // The template reads the script's variables in place
+    RenderContext t_ctx(*ctx.localNames, ctx.locals);
+
+    std::shared_ptr<const CompiledTemplate> page = Template::load(templatePath);
+    ctx.res.status = "200 OK";
+    ctx.redirected = false;
+    ctx.res.headers["Content-Type"] = "text/html";
+
+    if (ctx.res.stream && !ctx.res.stream->started()) {
+        // Streaming route: headers go out now, the page follows in chunks
+        // while it renders. Later statements can no longer change it. The
+        // worker sends the last chunk once the script is done.
+        ctx.res.stream->begin(ctx.res);
+        if (page) Template::render(*page, t_ctx, *ctx.res.stream);
+        return;
+    }
+
+    ctx.res.body = page ? Template::render(*page, t_ctx) : "";
+}
+
+void command_save_session(ScriptContext&, const std::string& sid, const std::string& user) {
+    LOG(LogLevel::INFO, "[AST] Saving session for user: " + user);
+    SessionStore::save(sid, user);
+}
+
+void command_add_cookie(ScriptContext& ctx, const std::string& key, const std::string& val) {
+    LOG(LogLevel::INFO, "[AST] Setting cookie: " + key + "=" + val);
+    ctx.res.add_cookie(key, val);
+}
+
+void command_redirect(ScriptContext& ctx, const std::string& url) {
+    LOG(LogLevel::INFO, "[AST] Redirecting to: " + url);
+    ctx.res.status = "302 Found";
+    ctx.redirected = true;
+    ctx.res.headers["Location"] = url;
+    ctx.res.body = ""; 
+}
+
+Value ForStmt::reduce(ScriptContext& ctx) const {
     if (ctx.lists.count(listName)) {
-        Logger::log(LogLevel::DEBUG, "[AST] Entering loop over list: " + listName);
-        Value oldVal = ctx.vars.count(itemVar) ? ctx.vars[itemVar] : Value();
+        LOG(LogLevel::DEBUG, "[AST] Entering loop over list: " + listName);
+        Value oldVal = ctx.locals[itemSlot].value_or(Value());
 
         size_t count = 0;
         for (const auto& itemMap : ctx.lists.at(listName)) {
             if (itemMap.count("value")) {
-                ctx.vars[itemVar] = itemMap.at("value");
-                body->reduce(ctx);
+                ctx.locals[itemSlot] = Value(itemMap.at("value"));
+                eval_or_empty(body, ctx);
                 count++;
             }
         }
-        Logger::log(LogLevel::DEBUG, "[AST] Loop finished. Iterations: " + std::to_string(count));
-        ctx.vars[itemVar] = oldVal;
+        LOG(LogLevel::DEBUG, "[AST] Loop finished. Iterations: " + std::to_string(count));
+        ctx.locals[itemSlot] = oldVal;
     } else {
-        Logger::log(LogLevel::WARN, "[AST] For loop failed: list '" + listName + "' not found");
+        LOG(LogLevel::WARN, "[AST] For loop failed: list '" + listName + "' not found");
     }
     return Value();
 }
 
-Value ListLiteralExpr::reduce(ScriptContext& ctx) {
+Value ListLiteralExpr::reduce(ScriptContext& ctx) const {
     std::vector<Value> listResult;
     for (auto& element : elements) {
-        listResult.push_back(element->reduce(ctx));
+        listResult.push_back(eval_or_empty(element, ctx));
     }
-    Logger::log(LogLevel::DEBUG, "[AST] Created List Literal with " + std::to_string(listResult.size()) + " elements");
-    return Value(listResult);
+    LOG(LogLevel::DEBUG, "[AST] Created List Literal with " + std::to_string(listResult.size()) + " elements");
+    return Value(std::move(listResult));
 }
 
-Value ObjectLiteralExpr::reduce(ScriptContext& ctx) {
+Value ObjectLiteralExpr::reduce(ScriptContext& ctx) const {
     std::map<std::string, Value> objResult;
     for (auto const& [key, expr] : pairs) {
-        objResult[key] = expr->reduce(ctx);
+        objResult[key] = eval_or_empty(expr, ctx);
     }
-    Logger::log(LogLevel::DEBUG, "[AST] Created Object Literal with " + std::to_string(objResult.size()) + " pairs");
-    return Value(objResult);
+    LOG(LogLevel::DEBUG, "[AST] Created Object Literal with " + std::to_string(objResult.size()) + " pairs");
+    return Value(std::move(objResult));
 }
\ No newline at end of file
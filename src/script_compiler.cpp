@@ -0,0 +1,202 @@
+#include "script_vm.hpp"
+#include "script_ast.hpp"
+#include <limits>
+#include <stdexcept>
+
+static constexpr size_t MAX_OPERAND = std::numeric_limits<uint16_t>::max();
+
+static uint16_t operand(size_t n, const char* what) {
+    if (n > MAX_OPERAND) throw std::runtime_error(std::string("Compiler Error: too many ") + what);
+    return static_cast<uint16_t>(n);
+}
+
+Bytecode ScriptCompiler::compile(const ASTNode& program) {
+    ScriptCompiler compiler;
+    compiler.statement(&program);
+    compiler.emit(Op::HALT);
+    return std::move(compiler.out);
+}
+
+void ScriptCompiler::statement(const ASTNode* node) {
+    if (!node) return;
+    // An expression used as a statement still runs, into a scratch register
+    uint16_t scratch = alloc();
+    node->compile(*this, scratch);
+    release(scratch);
+}
+
+void ScriptCompiler::expression(const ASTNode* node, uint16_t dst) {
+    if (node) node->compile(*this, dst);
+    else emit(Op::LOAD_CONST, dst, constant(Value()));
+}
+
+size_t ScriptCompiler::emit(Op op, uint16_t a, uint16_t b, uint16_t c) {
+    operand(out.code.size(), "instructions");
+    out.code.push_back({op, a, b, c});
+    return out.code.size() - 1;
+}
+
+uint16_t ScriptCompiler::target(size_t at) const {
+    return operand(at, "instructions");
+}
+
+uint16_t ScriptCompiler::constant(Value v) {
+    out.constants.push_back(std::move(v));
+    return operand(out.constants.size() - 1, "constants");
+}
+
+uint16_t ScriptCompiler::ref(const VarRef& r) {
+    out.refs.push_back(r);
+    return operand(out.refs.size() - 1, "names");
+}
+
+uint16_t ScriptCompiler::keySet(std::vector<std::string> keys) {
+    out.keySets.push_back(std::move(keys));
+    return operand(out.keySets.size() - 1, "objects");
+}
+
+uint16_t ScriptCompiler::loop(const std::string& list, uint16_t item) {
+    out.loops.push_back({list, item});
+    return operand(out.loops.size() - 1, "loops");
+}
+
+uint16_t ScriptCompiler::alloc(size_t count) {
+    uint16_t first = top;
+    top = operand(top + count, "registers");
+    if (top > out.registers) out.registers = top;
+    return first;
+}
+
+// --- Expressions ---
+
+void LiteralExpr::compile(ScriptCompiler& out, uint16_t dst) const {
+    out.emit(Op::LOAD_CONST, dst, out.constant(val));
+}
+
+void VariableExpr::compile(ScriptCompiler& out, uint16_t dst) const {
+    if (ref.scope == VarScope::LOCAL) out.emit(Op::LOAD_LOCAL, dst, ref.slot);
+    else out.emit(Op::LOAD_VAR, dst, out.ref(ref));
+}
+
+void BinaryExpr::compile(ScriptCompiler& out, uint16_t dst) const {
+    // Both sides always run, left first, as in reduce()
+    out.expression(left.get(), dst);
+    uint16_t rhs = out.alloc();
+    out.expression(right.get(), rhs);
+
+    switch (op) {
+        case TokenType::PLUS:        out.emit(Op::ADD, dst, dst, rhs); break;
+        case TokenType::MINUS:       out.emit(Op::SUB, dst, dst, rhs); break;
+        case TokenType::STAR:        out.emit(Op::MUL, dst, dst, rhs); break;
+        case TokenType::SLASH:       out.emit(Op::DIV, dst, dst, rhs); break;
+        case TokenType::EQUAL_EQUAL: out.emit(Op::EQ, dst, dst, rhs); break;
+        case TokenType::BANG_EQUAL:  out.emit(Op::NE, dst, dst, rhs); break;
+        case TokenType::LESS:        out.emit(Op::LT, dst, dst, rhs); break;
+        case TokenType::GREATER:     out.emit(Op::GT, dst, dst, rhs); break;
+        default:                     out.emit(Op::LOAD_CONST, dst, out.constant(Value())); break;
+    }
+    out.release(rhs);
+}
+
+void ListLiteralExpr::compile(ScriptCompiler& out, uint16_t dst) const {
+    uint16_t first = out.alloc(elements.size());
+    for (size_t i = 0; i < elements.size(); i++) {
+        out.expression(elements[i].get(), first + i);
+    }
+    out.emit(Op::MAKE_LIST, dst, first, operand(elements.size(), "list elements"));
+    out.release(first);
+}
+
+void ObjectLiteralExpr::compile(ScriptCompiler& out, uint16_t dst) const {
+    uint16_t first = out.alloc(pairs.size());
+    std::vector<std::string> keys;
+    for (auto const& [key, expr] : pairs) {
+        out.expression(expr.get(), first + keys.size());
+        keys.push_back(key);
+    }
+    out.emit(Op::MAKE_OBJECT, dst, first, out.keySet(std::move(keys)));
+    out.release(first);
+}
+
+// --- Statements ---
+
+void BlockStmt::compile(ScriptCompiler& out, uint16_t) const {
+    // After each statement but the last, leave the block if it redirected
+    std::vector<size_t> exits;
+    for (size_t i = 0; i < statements.size(); i++) {
+        out.statement(statements[i].get());
+        if (i + 1 < statements.size()) exits.push_back(out.emit(Op::JUMP_IF_REDIRECT));
+    }
+    for (size_t at : exits) out.out.code[at].a = out.target(out.here());
+}
+
+void AssignmentStmt::compile(ScriptCompiler& out, uint16_t dst) const {
+    if (!expression) out.emit(Op::LOG_ERROR, out.constant("[AST] set " + varName + ": missing expression"));
+    out.expression(expression.get(), dst);
+    out.emit(Op::STORE_LOCAL, dst, slot);
+}
+
+void IfStmt::compile(ScriptCompiler& out, uint16_t dst) const {
+    out.expression(condition.get(), dst);
+    size_t toElse = out.emit(Op::JUMP_IF_FALSE, dst);
+    out.statement(thenBranch.get());
+
+    if (elseBranch) {
+        size_t toEnd = out.emit(Op::JUMP);
+        out.out.code[toElse].b = out.target(out.here());
+        out.statement(elseBranch.get());
+        out.out.code[toEnd].a = out.target(out.here());
+    } else {
+        out.out.code[toElse].b = out.target(out.here());
+    }
+}
+
+void RenderStmt::compile(ScriptCompiler& out, uint16_t dst) const {
+    if (arguments.empty()) return;
+    out.expression(arg(0), dst);
+    out.emit(Op::RENDER, dst);
+}
+
+void SaveSessionStmt::compile(ScriptCompiler& out, uint16_t dst) const {
+    if (arguments.size() < 2) {
+        out.emit(Op::LOG_ERROR, out.constant(std::string("[AST] save_session: missing arguments")));
+        return;
+    }
+    uint16_t user = out.alloc();
+    out.expression(arg(0), dst);
+    out.expression(arg(1), user);
+    out.emit(Op::SAVE_SESSION, dst, user);
+    out.release(user);
+}
+
+void AddCookieStmt::compile(ScriptCompiler& out, uint16_t dst) const {
+    uint16_t val = out.alloc();
+    out.expression(arg(0), dst);
+    out.expression(arg(1), val);
+    out.emit(Op::ADD_COOKIE, dst, val);
+    out.release(val);
+}
+
+void RedirectStmt::compile(ScriptCompiler& out, uint16_t dst) const {
+    if (arguments.empty()) {
+        out.emit(Op::LOG_ERROR, out.constant(std::string("[AST] Redirect command missing URL")));
+        return;
+    }
+    out.expression(arg(0), dst);
+    out.emit(Op::REDIRECT, dst);
+}
+
+void ForStmt::compile(ScriptCompiler& out, uint16_t) const {
+    // a = the item variable's old value, a+1 = position in the list
+    uint16_t state = out.alloc(2);
+    uint16_t id = out.loop(listName, itemSlot);
+
+    size_t prep = out.emit(Op::FOR_PREP, state, id);
+    size_t next = out.emit(Op::FOR_NEXT, state, id);
+    out.statement(body.get());
+    out.emit(Op::JUMP, out.target(next));
+    out.out.code[next].c = out.target(out.here());
+    out.emit(Op::FOR_END, state, id);
+    out.out.code[prep].c = out.target(out.here());
+    out.release(state);
+}
@@ -1,28 +1,90 @@
 #include "script_lexer.hpp"
-#include <cctype>
-#include <map>
+#include <array>
+#include <cstdint>
+
+// --- Character classes ---
+
+enum CharClass : uint8_t {
+    SPACE       = 1 << 0,
+    DIGIT       = 1 << 1,
+    IDENT_START = 1 << 2,  // a-z A-Z _
+    IDENT       = 1 << 3,  // a-z A-Z 0-9 _ .
+};
+
+static constexpr std::array<uint8_t, 256> make_char_classes() {
+    std::array<uint8_t, 256> table{};
+    for (unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) table[c] |= SPACE;
+    for (int c = '0'; c <= '9'; c++) table[c] |= DIGIT | IDENT;
+    for (int c = 'a'; c <= 'z'; c++) table[c] |= IDENT_START | IDENT;
+    for (int c = 'A'; c <= 'Z'; c++) table[c] |= IDENT_START | IDENT;
+    table['_'] |= IDENT_START | IDENT;
+    table['.'] |= IDENT;
+    return table;
+}
+
+static constexpr std::array<uint8_t, 256> char_classes = make_char_classes();
+
+static bool is(char c, CharClass cls) {
+    return char_classes[static_cast<unsigned char>(c)] & cls;
+}
+
+// --- Keywords ---
+
+// Perfect hash over the keyword set: every keyword lands in its own slot,
+// so a lookup is one hash and at most one compare
+static constexpr size_t keyword_slot(std::string_view word) {
+    return (word.size() + static_cast<unsigned char>(word.front()) +
+            2 * static_cast<unsigned char>(word.back())) & 15;
+}
+
+struct Keyword {
+    std::string_view word;
+    TokenType type;
+};
+
+static constexpr Keyword keyword_list[] = {
+    {"set", TokenType::SET},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE},
+    {"for", TokenType::FOR},
+    {"end", TokenType::END},
+    {"render", TokenType::RENDER},
+    {"redirect", TokenType::REDIRECT},
+    {"save_session", TokenType::SAVE_SESSION},
+    {"add_cookie", TokenType::ADD_COOKIE},
+    {"set_session", TokenType::SET_SESSION},
+};
+
+static constexpr std::array<Keyword, 16> make_keyword_table() {
+    std::array<Keyword, 16> table{};
+    for (const Keyword& kw : keyword_list) table[keyword_slot(kw.word)] = kw;
+    return table;
+}
+
+static constexpr std::array<Keyword, 16> keyword_table = make_keyword_table();
+
+static constexpr bool keywords_collide() {
+    for (const Keyword& kw : keyword_list) {
+        if (keyword_table[keyword_slot(kw.word)].word != kw.word) return true;
+    }
+    return false;
+}
+static_assert(!keywords_collide(), "keyword_slot no longer gives every keyword its own slot");
+
+static TokenType identifier_type(std::string_view text) {
+    const Keyword& kw = keyword_table[keyword_slot(text)];
+    return kw.word == text ? kw.type : TokenType::IDENTIFIER;
+}
 
 std::vector<Token> ScriptLexer::tokenize() {
     std::vector<Token> tokens;
-
-    // Map for keyword lookups
-    static const std::map<std::string, TokenType> keywords = {
-        {"set", TokenType::SET},
-        {"if", TokenType::IF},
-        {"else", TokenType::ELSE},
-        {"for", TokenType::FOR},
-        {"end", TokenType::END},
-        {"render", TokenType::RENDER},
-        {"redirect", TokenType::REDIRECT},
-        {"save_session", TokenType::SAVE_SESSION},
-        {"add_cookie",   TokenType::ADD_COOKIE},
-        {"set_session",  TokenType::SET_SESSION}
-    };
+    tokens.reserve(source.size() / 4 + 1);
 
     while (!isAtEnd()) {
+        size_t start = cursor;
         char c = next();
 
-        if (std::isspace(c)) {
+        if (is(c, SPACE)) {
             if (c == '\n') line++;
             continue;
         }
@@ -34,78 +96,71 @@ std::vector<Token> ScriptLexer::tokenize() {
         }
 
         // Numbers
-        if (std::isdigit(c)) {
-            std::string num(1, c);
-            while (std::isdigit(peek())) num += next();
-            tokens.push_back({TokenType::NUMBER, num, line});
+        if (is(c, DIGIT)) {
+            while (is(peek(), DIGIT)) next();
+            tokens.push_back({TokenType::NUMBER, source.substr(start, cursor - start), line});
         }
         // Identifiers and Keywords
-        else if (std::isalpha(c) || c == '_') {
-            std::string text(1, c);
-            while (std::isalnum(peek()) || peek() == '_' || peek() == '.') {
-                text += next();
-            }
-            
-            if (keywords.count(text)) {
-                tokens.push_back({keywords.at(text), text, line});
-            } else {
-                tokens.push_back({TokenType::IDENTIFIER, text, line});
-            }
+        else if (is(c, IDENT_START)) {
+            while (is(peek(), IDENT)) next();
+            std::string_view text = source.substr(start, cursor - start);
+            tokens.push_back({identifier_type(text), text, line});
         }
         // String Literals
         else if (c == '"' || c == '\'') {
             char quote = c;
-            std::string str;
             while (peek() != quote && !isAtEnd()) {
                 if (peek() == '\n') line++;
-                str += next();
+                next();
             }
+            std::string_view str = source.substr(start + 1, cursor - start - 1);
             if (!isAtEnd()) next(); // Consume closing quote
             tokens.push_back({TokenType::STRING, str, line});
         }
         // Operators (Multi-character check)
         else {
+            TokenType type;
             switch (c) {
                 case '=':
                     if (peek() == '=') {
                         next();
-                        tokens.push_back({TokenType::EQUAL_EQUAL, "==", line});
+                        type = TokenType::EQUAL_EQUAL;
                     } else {
-                        tokens.push_back({TokenType::EQUAL, "=", line});
+                        type = TokenType::EQUAL;
                     }
                     break;
                 case '!':
-                    if (peek() == '=') {
-                        next();
-                        tokens.push_back({TokenType::BANG_EQUAL, "!=", line});
-                    }
+                    if (peek() != '=') continue;
+                    next();
+                    type = TokenType::BANG_EQUAL;
                     break;
-                case '<': tokens.push_back({TokenType::LESS, "<", line}); break;
-                case '>': tokens.push_back({TokenType::GREATER, ">", line}); break;
-                case '+': tokens.push_back({TokenType::PLUS, "+", line}); break;
-                case '-': tokens.push_back({TokenType::MINUS, "-", line}); break;
-                case '*': tokens.push_back({TokenType::STAR, "*", line}); break;
-                case '/': tokens.push_back({TokenType::SLASH, "/", line}); break;
-                case '(': tokens.push_back({TokenType::LPAREN, "(", line}); break;
-                case ')': tokens.push_back({TokenType::RPAREN, ")", line}); break;
-                case '[': tokens.push_back({TokenType::L_BRACKET, "{", line}); break;
-                case ']': tokens.push_back({TokenType::R_BRACKET, "}", line}); break;
-                case '{': tokens.push_back({TokenType::L_BRACE, "[", line}); break;
-                case '}': tokens.push_back({TokenType::R_BRACE, "]", line}); break;
-                case ':': tokens.push_back({TokenType::COLON, ":", line}); break;
-                case ';': tokens.push_back({TokenType::SEMICOLON, ";", line}); break;
-                case ',': tokens.push_back({TokenType::COMMA, ",", line}); break;
+                case '<': type = TokenType::LESS; break;
+                case '>': type = TokenType::GREATER; break;
+                case '+': type = TokenType::PLUS; break;
+                case '-': type = TokenType::MINUS; break;
+                case '*': type = TokenType::STAR; break;
+                case '/': type = TokenType::SLASH; break;
+                case '(': type = TokenType::LPAREN; break;
+                case ')': type = TokenType::RPAREN; break;
+                case '[': type = TokenType::L_BRACKET; break;
+                case ']': type = TokenType::R_BRACKET; break;
+                case '{': type = TokenType::L_BRACE; break;
+                case '}': type = TokenType::R_BRACE; break;
+                case ':': type = TokenType::COLON; break;
+                case ';': type = TokenType::SEMICOLON; break;
+                case ',': type = TokenType::COMMA; break;
                 default:
                     // Log unknown character or throw error
-                    break;
+                    continue;
             }
+            tokens.push_back({type, source.substr(start, cursor - start), line});
         }
     }
 
-    tokens.push_back({TokenType::EOF_TOKEN, "", line});
+    tokens.push_back({TokenType::EOF_TOKEN, {}, line});
     return tokens;
 }
 
 bool ScriptLexer::isAtEnd() {
     return cursor >= source.size();
-}
\ No newline at end of file
+}
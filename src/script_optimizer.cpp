@@ -0,0 +1,148 @@
+#include "script_optimizer.hpp"
+#include "script_ast.hpp"
+#include <limits>
+
+static size_t count(const std::unique_ptr<ASTNode>& node) {
+    return node ? node->nodeCount() : 0;
+}
+
+static size_t count(const std::vector<std::unique_ptr<ASTNode>>& nodes) {
+    size_t n = 0;
+    for (const auto& node : nodes) n += count(node);
+    return n;
+}
+
+static const Value* literal(const std::unique_ptr<ASTNode>& node) {
+    return node ? node->constant() : nullptr;
+}
+
+size_t ScriptOptimizer::optimize(std::unique_ptr<ASTNode>& program) {
+    size_t before = count(program);
+    ScriptOptimizer opt;
+    opt.visit(program);
+    return before - count(program);
+}
+
+void ScriptOptimizer::visit(std::unique_ptr<ASTNode>& slot) {
+    if (!slot) return;
+    if (auto replacement = slot->optimize(*this)) {
+        if (!replacement->line) replacement->line = slot->line;
+        slot = std::move(replacement);
+    }
+}
+
+// True if `op` on these ints gives the same int at run time, without
+// overflow (which would be undefined) or division by zero (which logs)
+static bool safe_arithmetic(TokenType op, int l, int r) {
+    long long result;
+    switch (op) {
+        case TokenType::PLUS:  result = static_cast<long long>(l) + r; break;
+        case TokenType::MINUS: result = static_cast<long long>(l) - r; break;
+        case TokenType::STAR:  result = static_cast<long long>(l) * r; break;
+        case TokenType::SLASH:
+            if (r == 0) return false;
+            result = static_cast<long long>(l) / r;
+            break;
+        default: return true;
+    }
+    return result >= std::numeric_limits<int>::min() && result <= std::numeric_limits<int>::max();
+}
+
+// --- Expressions ---
+
+std::unique_ptr<ASTNode> VariableExpr::optimize(ScriptOptimizer&) { return nullptr; }
+size_t VariableExpr::nodeCount() const { return 1; }
+
+std::unique_ptr<ASTNode> BinaryExpr::optimize(ScriptOptimizer& opt) {
+    opt.visit(left);
+    opt.visit(right);
+
+    const Value* l = literal(left);
+    const Value* r = literal(right);
+    if (!l || !r) return nullptr;
+
+    bool arithmetic = op == TokenType::PLUS || op == TokenType::MINUS ||
+                      op == TokenType::STAR || op == TokenType::SLASH;
+    if (arithmetic && !(l->isInt() && r->isInt() && safe_arithmetic(op, l->asInt(), r->asInt()))) {
+        return nullptr;
+    }
+    return std::make_unique<LiteralExpr>(apply_binary(op, *l, *r));
+}
+size_t BinaryExpr::nodeCount() const { return 1 + count(left) + count(right); }
+
+std::unique_ptr<ASTNode> ListLiteralExpr::optimize(ScriptOptimizer& opt) {
+    std::vector<Value> items;
+    for (auto& element : elements) {
+        opt.visit(element);
+        if (const Value* v = literal(element)) items.push_back(*v);
+    }
+    if (items.size() != elements.size()) return nullptr;
+    return std::make_unique<LiteralExpr>(Value(std::move(items)));
+}
+size_t ListLiteralExpr::nodeCount() const { return 1 + count(elements); }
+
+std::unique_ptr<ASTNode> ObjectLiteralExpr::optimize(ScriptOptimizer& opt) {
+    std::map<std::string, Value> fields;
+    for (auto& [key, expr] : pairs) {
+        opt.visit(expr);
+        if (const Value* v = literal(expr)) fields[key] = *v;
+    }
+    if (fields.size() != pairs.size()) return nullptr;
+    return std::make_unique<LiteralExpr>(Value(std::move(fields)));
+}
+size_t ObjectLiteralExpr::nodeCount() const {
+    size_t n = 1;
+    for (const auto& [key, expr] : pairs) n += count(expr);
+    return n;
+}
+
+// --- Statements ---
+
+std::unique_ptr<ASTNode> BlockStmt::optimize(ScriptOptimizer& opt) {
+    // Splicing a nested block in is safe: both check for a redirect after
+    // each statement, and an empty or literal statement can't redirect.
+    std::vector<std::unique_ptr<ASTNode>> kept;
+    for (auto& s : statements) {
+        opt.visit(s);
+        if (!s || s->constant()) continue;
+        if (auto* block = dynamic_cast<BlockStmt*>(s.get())) {
+            for (auto& inner : block->statements) kept.push_back(std::move(inner));
+            continue;
+        }
+        kept.push_back(std::move(s));
+    }
+    statements = std::move(kept);
+    return nullptr;
+}
+size_t BlockStmt::nodeCount() const { return 1 + count(statements); }
+
+std::unique_ptr<ASTNode> AssignmentStmt::optimize(ScriptOptimizer& opt) {
+    opt.visit(expression);
+    return nullptr;
+}
+size_t AssignmentStmt::nodeCount() const { return 1 + count(expression); }
+
+std::unique_ptr<ASTNode> IfStmt::optimize(ScriptOptimizer& opt) {
+    opt.visit(condition);
+    opt.visit(thenBranch);
+    opt.visit(elseBranch);
+
+    const Value* cond = literal(condition);
+    if (!cond) return nullptr;
+
+    std::unique_ptr<ASTNode> taken = cond->isTruthy() ? std::move(thenBranch) : std::move(elseBranch);
+    return taken ? std::move(taken) : std::make_unique<BlockStmt>();
+}
+size_t IfStmt::nodeCount() const { return 1 + count(condition) + count(thenBranch) + count(elseBranch); }
+
+std::unique_ptr<ASTNode> CommandStmt::optimize(ScriptOptimizer& opt) {
+    for (auto& arg : arguments) opt.visit(arg);
+    return nullptr;
+}
+size_t CommandStmt::nodeCount() const { return 1 + count(arguments); }
+
+std::unique_ptr<ASTNode> ForStmt::optimize(ScriptOptimizer& opt) {
+    opt.visit(body);
+    return nullptr;
+}
+size_t ForStmt::nodeCount() const { return 1 + count(body); }
@@ -1,5 +1,14 @@
 #include "script_parser.hpp"
 #include <stdexcept>
+#include <charconv>
+
+// std::stoi without the temporary string; throws what stoi would
+static int parse_int(std::string_view digits) {
+    int result = 0;
+    auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), result);
+    if (ec == std::errc::result_out_of_range) throw std::out_of_range("stoi");
+    return result;
+}
 
 Precedence ScriptParser::getPrecedence(TokenType type) {
     switch (type) {
@@ -17,6 +26,13 @@ Precedence ScriptParser::getPrecedence(TokenType type) {
     }
 }
 
+// Stamps the source line a node starts on (shown by the profiler)
+template <typename T>
+static std::unique_ptr<T> at_line(int line, std::unique_ptr<T> node) {
+    if (node) node->line = line;
+    return node;
+}
+
 std::unique_ptr<ASTNode> ScriptParser::parseProgram() {
     auto block = std::make_unique<BlockStmt>();
     while (peek().type != TokenType::EOF_TOKEN) {
@@ -26,13 +42,15 @@ std::unique_ptr<ASTNode> ScriptParser::parseProgram() {
 }
 
 std::unique_ptr<ASTNode> ScriptParser::parseStatement() {
+    int line = peek().line;
+
     if (peek().type == TokenType::SET) {
         advance(); // consume 'set'
-        Token name = peek();
+        const Token& name = peek();
         consume(TokenType::IDENTIFIER, "Expect variable name");
         consume(TokenType::EQUAL, "Expect '='");
         auto expr = parseExpression(NONE);
-        return std::make_unique<AssignmentStmt>(name.value, std::move(expr));
+        return at_line(line, std::make_unique<AssignmentStmt>(std::string(name.value), std::move(expr)));
     }
 
     if (peek().type == TokenType::IF) {
@@ -54,7 +72,7 @@ std::unique_ptr<ASTNode> ScriptParser::parseStatement() {
             elseBranch = std::move(elseBlock);
         }
         consume(TokenType::END, "Expect 'end'");
-        return std::make_unique<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+        return at_line(line, std::make_unique<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch)));
     }
 
     if (peek().type == TokenType::RENDER || 
@@ -62,7 +80,7 @@ std::unique_ptr<ASTNode> ScriptParser::parseStatement() {
         peek().type == TokenType::ADD_COOKIE ||
         peek().type == TokenType::SAVE_SESSION) {
 
-        Token cmd = advance();
+        TokenType cmd = advance().type;
         std::vector<std::unique_ptr<ASTNode>> args;
 
         // Simple heuristic: parse expressions until we hit a keyword or EOF
@@ -71,28 +89,33 @@ std::unique_ptr<ASTNode> ScriptParser::parseStatement() {
                peek().type != TokenType::SEMICOLON ) 
         { args.push_back(parseExpression(NONE)); }
 
-        return std::make_unique<CommandStmt>(cmd.value, std::move(args));
+        switch (cmd) {
+            case TokenType::RENDER:     return at_line(line, std::make_unique<RenderStmt>(std::move(args)));
+            case TokenType::REDIRECT:   return at_line(line, std::make_unique<RedirectStmt>(std::move(args)));
+            case TokenType::ADD_COOKIE: return at_line(line, std::make_unique<AddCookieStmt>(std::move(args)));
+            default:                    return at_line(line, std::make_unique<SaveSessionStmt>(std::move(args)));
+        }
     }
 
     return parseExpression(NONE);
 }
 
 std::unique_ptr<ASTNode> ScriptParser::parseExpression(Precedence prec) {
-    Token token = advance();
+    const Token& token = advance();
     std::unique_ptr<ASTNode> left;
 
     // Prefix (Nud)
     switch (token.type) {
         case TokenType::NUMBER:
-            left = std::make_unique<LiteralExpr>(std::stoi(token.value));
+            left = std::make_unique<LiteralExpr>(parse_int(token.value));
             break;
 
         case TokenType::STRING:
-            left = std::make_unique<LiteralExpr>(token.value);
+            left = std::make_unique<LiteralExpr>(std::string(token.value));
             break;
 
         case TokenType::IDENTIFIER:
-            left = std::make_unique<VariableExpr>(token.value);
+            left = std::make_unique<VariableExpr>(std::string(token.value));
             break;
 
         case TokenType::LPAREN:
@@ -113,22 +136,26 @@ std::unique_ptr<ASTNode> ScriptParser::parseExpression(Precedence prec) {
             break;
     }
 
+    // A parenthesized expression keeps the line of what is inside
+    if (left && !left->line) left->line = token.line;
+
     // Infix (Led)
     while (prec < getPrecedence(peek().type)) {
-        TokenType op = advance().type;
+        const Token& opToken = advance();
+        TokenType op = opToken.type;
         auto right = parseExpression(getPrecedence(op));
-        left = std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+        left = at_line(opToken.line, std::make_unique<BinaryExpr>(std::move(left), op, std::move(right)));
     }
 
     return left;
 }
 
-void ScriptParser::consume(TokenType type, std::string msg) {
+void ScriptParser::consume(TokenType type, const char* msg) {
     if (peek().type == type) {
         advance();
         return;
     }
-    throw std::runtime_error("Parser Error: " + msg + " on line " + std::to_string(peek().line));
+    throw std::runtime_error(std::string("Parser Error: ") + msg + " on line " + std::to_string(peek().line));
 }
 
 std::unique_ptr<ASTNode> ScriptParser::parseList() {
@@ -151,7 +178,7 @@ std::unique_ptr<ASTNode> ScriptParser::parseObject() {
     if (peek().type != TokenType::R_BRACE) {
         do {
             // We expect a literal identifier or string as the key
-            std::string key = advance().value; 
+            std::string key(advance().value);
             consume(TokenType::COLON, "Expected ':' after key");
             
             // The value can be any expression, including another object!
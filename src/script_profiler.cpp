@@ -0,0 +1,174 @@
+#include "script_profiler.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+std::atomic<bool> ScriptProfiler::on{false};
+
+struct ProfileFrame {
+    std::string name;
+    int line;
+    bool operator<(const ProfileFrame& o) const { return std::tie(name, line) < std::tie(o.name, o.line); }
+    bool operator==(const ProfileFrame& o) const { return line == o.line && name == o.name; }
+};
+
+struct ProfileStat {
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t selfNs = 0;
+};
+
+using ProfileStack = std::vector<ProfileFrame>;
+
+// Call tree: one node per distinct stack, so closing a frame is a pointer
+// away from its counters instead of a lookup by the whole stack
+struct ProfileNode {
+    ProfileStat stat;
+    std::map<ProfileFrame, std::unique_ptr<ProfileNode>> children;
+};
+
+// One per thread that has run a profiled script. Only that thread walks
+// `open`; the tree is also read by dump(), hence the (uncontended) lock.
+struct ThreadProfile {
+    std::mutex mtx;
+    ProfileNode root;
+    std::vector<ProfileNode*> open{&root};
+    std::vector<uint64_t> childNs{0}; // time spent in each open frame's children
+};
+
+static std::mutex registry_mtx;
+static std::vector<std::shared_ptr<ThreadProfile>> registry;
+
+static ThreadProfile& local_profile() {
+    thread_local std::shared_ptr<ThreadProfile> profile = [] {
+        auto p = std::make_shared<ThreadProfile>();
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        registry.push_back(p);
+        return p;
+    }();
+    return *profile;
+}
+
+ScriptProfiler::Scope::Scope(std::string name, int line) {
+    ThreadProfile& p = local_profile();
+    ProfileNode* node;
+    {
+        std::lock_guard<std::mutex> lock(p.mtx);
+        auto& child = p.open.back()->children[{std::move(name), line}];
+        if (!child) child = std::make_unique<ProfileNode>();
+        node = child.get();
+    }
+    p.open.push_back(node);
+    p.childNs.push_back(0);
+    start = std::chrono::steady_clock::now();
+}
+
+ScriptProfiler::Scope::~Scope() {
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    ThreadProfile& p = local_profile();
+
+    uint64_t children = p.childNs.back();
+    {
+        std::lock_guard<std::mutex> lock(p.mtx);
+        ProfileStat& stat = p.open.back()->stat;
+        stat.calls++;
+        stat.totalNs += ns;
+        stat.selfNs += ns > children ? ns - children : 0;
+    }
+
+    p.open.pop_back();
+    p.childNs.pop_back();
+    p.childNs.back() += ns;
+}
+
+// Adds every stack under `node` to `out`, keyed by its frames from the root
+static void flatten(const ProfileNode& node, ProfileStack& path, std::map<ProfileStack, ProfileStat>& out) {
+    for (const auto& [frame, child] : node.children) {
+        path.push_back(frame);
+        ProfileStat& m = out[path];
+        m.calls += child->stat.calls;
+        m.totalNs += child->stat.totalNs;
+        m.selfNs += child->stat.selfNs;
+        flatten(*child, path, out);
+        path.pop_back();
+    }
+}
+
+static std::string frame_label(const ProfileFrame& f) {
+    return f.line ? f.name + " (line " + std::to_string(f.line) + ")" : f.name;
+}
+
+void ScriptProfiler::dump(const std::string& prefix) {
+    // 1. Merge every thread's tree
+    std::map<ProfileStack, ProfileStat> merged;
+    {
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        for (const auto& p : registry) {
+            std::lock_guard<std::mutex> treeLock(p->mtx);
+            ProfileStack path;
+            flatten(p->root, path, merged);
+        }
+    }
+
+    // 2. Folded stacks: self time, so the flamegraph's widths add up
+    std::ofstream folded(prefix + ".folded");
+    for (const auto& [stack, stat] : merged) {
+        if (!stat.selfNs) continue;
+        for (size_t i = 0; i < stack.size(); i++) {
+            std::string label = frame_label(stack[i]);
+            std::replace(label.begin(), label.end(), ';', ',');
+            folded << (i ? ";" : "") << label;
+        }
+        folded << " " << stat.selfNs << "\n";
+    }
+
+    // 3. Line report: per script (the outermost frame), per line and node.
+    // A frame nested in an identical one (1 + 2 + 3) adds no total, or the
+    // time would be counted twice.
+    std::map<std::string, std::map<ProfileFrame, ProfileStat>> lines;
+    for (const auto& [stack, stat] : merged) {
+        if (stack.size() < 2) continue;
+        ProfileStat& l = lines[stack.front().name][stack.back()];
+        l.calls += stat.calls;
+        l.selfNs += stat.selfNs;
+        if (std::find(stack.begin() + 1, stack.end() - 1, stack.back()) == stack.end() - 1) {
+            l.totalNs += stat.totalNs;
+        }
+    }
+
+    std::ofstream report(prefix + ".txt");
+    for (const auto& [script, frames] : lines) {
+        ProfileStat runs;
+        auto top = merged.find(ProfileStack{{script, 0}});
+        if (top != merged.end()) runs = top->second;
+        report << script << ": " << runs.calls << " runs, " << runs.totalNs / 1000 << " us\n";
+
+        // Source order; renders (line 0) last
+        std::vector<std::pair<ProfileFrame, ProfileStat>> rows(frames.begin(), frames.end());
+        std::stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+            return (a.first.line ? a.first.line : INT32_MAX) < (b.first.line ? b.first.line : INT32_MAX);
+        });
+
+        char row[160];
+        std::snprintf(row, sizeof(row), "  %6s %10s %12s %12s  %s\n", "line", "calls", "total us", "self us", "node");
+        report << row;
+        for (const auto& [frame, stat] : rows) {
+            std::snprintf(row, sizeof(row), "  %6s %10llu %12.1f %12.1f  %s\n",
+                          frame.line ? std::to_string(frame.line).c_str() : "-",
+                          static_cast<unsigned long long>(stat.calls),
+                          stat.totalNs / 1000.0, stat.selfNs / 1000.0, frame.name.c_str());
+            report << row;
+        }
+        report << "\n";
+    }
+
+    LOG(LogLevel::INFO, "Profiler: wrote " + prefix + ".txt and " + prefix + ".folded (" +
+        std::to_string(merged.size()) + " stacks)");
+}
@@ -0,0 +1,92 @@
+#include "script_resolver.hpp"
+#include "script_ast.hpp"
+#include <limits>
+#include <stdexcept>
+
+std::vector<std::string> ScriptResolver::resolve(ASTNode& program) {
+    ScriptResolver resolver;
+    program.resolve(resolver);
+    return std::move(resolver.locals);
+}
+
+VarRef ScriptResolver::read(const std::string& name) {
+    // Same prefixes, in the same order, as the old per-access checks
+    static const struct { const char* prefix; VarScope scope; } namespaces[] = {
+        {"form.", VarScope::FORM},
+        {"session.", VarScope::SESSION},
+        {"cookie.", VarScope::COOKIE},
+        {"param.", VarScope::PARAM},
+    };
+    for (const auto& ns : namespaces) {
+        if (name.rfind(ns.prefix, 0) == 0) {
+            return {ns.scope, 0, name.substr(std::char_traits<char>::length(ns.prefix))};
+        }
+    }
+    return {VarScope::LOCAL, write(name), ""};
+}
+
+uint16_t ScriptResolver::write(const std::string& name) {
+    auto it = slots.find(name);
+    if (it != slots.end()) return it->second;
+
+    if (locals.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("Resolver Error: too many variables");
+    }
+    uint16_t slot = static_cast<uint16_t>(locals.size());
+    locals.push_back(name);
+    slots.emplace(name, slot);
+    return slot;
+}
+
+// --- Expressions ---
+
+void VariableExpr::resolve(ScriptResolver& names) {
+    ref = names.read(varName);
+}
+
+void BinaryExpr::resolve(ScriptResolver& names) {
+    if (left) left->resolve(names);
+    if (right) right->resolve(names);
+}
+
+void ListLiteralExpr::resolve(ScriptResolver& names) {
+    for (auto& element : elements) {
+        if (element) element->resolve(names);
+    }
+}
+
+void ObjectLiteralExpr::resolve(ScriptResolver& names) {
+    for (auto& [key, expr] : pairs) {
+        if (expr) expr->resolve(names);
+    }
+}
+
+// --- Statements ---
+
+void BlockStmt::resolve(ScriptResolver& names) {
+    for (auto& s : statements) {
+        if (s) s->resolve(names);
+    }
+}
+
+void AssignmentStmt::resolve(ScriptResolver& names) {
+    slot = names.write(varName);
+    if (expression) expression->resolve(names);
+}
+
+void IfStmt::resolve(ScriptResolver& names) {
+    if (condition) condition->resolve(names);
+    if (thenBranch) thenBranch->resolve(names);
+    if (elseBranch) elseBranch->resolve(names);
+}
+
+void CommandStmt::resolve(ScriptResolver& names) {
+    for (auto& arg : arguments) {
+        if (arg) arg->resolve(names);
+    }
+}
+
+void ForStmt::resolve(ScriptResolver& names) {
+    itemSlot = names.write(itemVar);
+    if (body) body->resolve(names);
+}
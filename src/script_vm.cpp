@@ -0,0 +1,127 @@
+#include "script_vm.hpp"
+#include "script_ast.hpp"
+#include "logic_engine.hpp"
+#include "logger.hpp"
+
+// Every opcode does what the matching reduce() does, minus the trace
+// logging: same Value operations in the same order, so the same results
+// and the same exceptions.
+void ScriptVM::run(const Bytecode& bc, ScriptContext& ctx) {
+    std::vector<Value> regs(bc.registers);
+    const Instr* code = bc.code.data();
+    const Instr* ip = code;
+
+#define R(field) regs[ip->field]
+
+#if defined(__GNUC__)
+    // Computed goto: one indirect jump per instruction, each from its own
+    // site, which the branch predictor handles far better than one switch
+    static const void* const labels[] = {
+#define SCRIPT_OP_LABEL(name) &&op_##name,
+        SCRIPT_OPS(SCRIPT_OP_LABEL)
+#undef SCRIPT_OP_LABEL
+    };
+#define CASE(name) op_##name:
+#define DISPATCH() goto *labels[static_cast<size_t>(ip->op)]
+    DISPATCH();
+#else
+#define CASE(name) case Op::name:
+#define DISPATCH() goto dispatch
+dispatch:
+    switch (ip->op) {
+#endif
+
+#define NEXT() do { ++ip; DISPATCH(); } while (0)
+#define JUMP_TO(at) do { ip = code + (at); DISPATCH(); } while (0)
+
+    CASE(LOAD_CONST)  R(a) = bc.constants[ip->b]; NEXT();
+    CASE(LOAD_LOCAL) {
+        const std::optional<Value>& local = ctx.locals[ip->b];
+        R(a) = local ? *local : lookup_variable(ctx, VarRef{VarScope::LOCAL, ip->b, ""});
+        NEXT();
+    }
+    CASE(STORE_LOCAL) ctx.locals[ip->b] = R(a); NEXT();
+    CASE(LOAD_VAR)    R(a) = lookup_variable(ctx, bc.refs[ip->b]); NEXT();
+
+    CASE(ADD)         R(a) = Value(R(b).asInt() + R(c).asInt()); NEXT();
+    CASE(SUB)         R(a) = Value(R(b).asInt() - R(c).asInt()); NEXT();
+    CASE(MUL)         R(a) = Value(R(b).asInt() * R(c).asInt()); NEXT();
+    CASE(DIV) {
+        if (R(c).asInt() == 0) {
+            LOG(LogLevel::ERR, "[AST] Runtime Error: Division by zero");
+            R(a) = Value(0);
+        } else {
+            R(a) = Value(R(b).asInt() / R(c).asInt());
+        }
+        NEXT();
+    }
+    CASE(EQ)          R(a) = Value(R(b) == R(c)); NEXT();
+    CASE(NE)          R(a) = Value(R(b) != R(c)); NEXT();
+    CASE(LT)          R(a) = Value(R(b) < R(c)); NEXT();
+    CASE(GT)          R(a) = Value(R(b) > R(c)); NEXT();
+
+    CASE(JUMP)        JUMP_TO(ip->a);
+    CASE(JUMP_IF_FALSE) {
+        if (!R(a).isTruthy()) JUMP_TO(ip->b);
+        NEXT();
+    }
+    CASE(JUMP_IF_REDIRECT) {
+        if (ctx.redirected) JUMP_TO(ip->a);
+        NEXT();
+    }
+
+    CASE(MAKE_LIST) {
+        std::vector<Value> list(regs.begin() + ip->b, regs.begin() + ip->b + ip->c);
+        R(a) = Value(std::move(list));
+        NEXT();
+    }
+    CASE(MAKE_OBJECT) {
+        const std::vector<std::string>& keys = bc.keySets[ip->c];
+        std::map<std::string, Value> obj;
+        for (size_t i = 0; i < keys.size(); i++) obj[keys[i]] = regs[ip->b + i];
+        R(a) = Value(std::move(obj));
+        NEXT();
+    }
+
+    CASE(RENDER)       command_render(ctx, R(a).asString()); NEXT();
+    CASE(SAVE_SESSION) command_save_session(ctx, R(a).asString(), R(b).asString()); NEXT();
+    CASE(ADD_COOKIE)   command_add_cookie(ctx, R(a).asString(), R(b).asString()); NEXT();
+    CASE(REDIRECT)     command_redirect(ctx, R(a).asString()); NEXT();
+    CASE(LOG_ERROR)    LOG(LogLevel::ERR, bc.constants[ip->a].asString()); NEXT();
+
+    CASE(FOR_PREP) {
+        const Bytecode::Loop& loop = bc.loops[ip->b];
+        if (!ctx.lists.count(loop.list)) {
+            LOG(LogLevel::WARN, "[AST] For loop failed: list '" + loop.list + "' not found");
+            JUMP_TO(ip->c);
+        }
+        R(a) = ctx.locals[loop.item].value_or(Value());
+        regs[ip->a + 1] = Value(0);
+        NEXT();
+    }
+    CASE(FOR_NEXT) {
+        // Items without a "value" are skipped, as in ForStmt::reduce()
+        const Bytecode::Loop& loop = bc.loops[ip->b];
+        const auto& items = ctx.lists.at(loop.list);
+        size_t i = regs[ip->a + 1].asInt();
+        while (i < items.size() && !items[i].count("value")) i++;
+        if (i >= items.size()) JUMP_TO(ip->c);
+
+        ctx.locals[loop.item] = Value(items[i].at("value"));
+        regs[ip->a + 1] = Value(static_cast<int>(i + 1));
+        NEXT();
+    }
+    CASE(FOR_END)      ctx.locals[bc.loops[ip->b].item] = R(a); NEXT();
+
+    CASE(HALT)         return;
+
+#if !defined(__GNUC__)
+    }
+#endif
+
+#undef JUMP_TO
+#undef NEXT
+#undef DISPATCH
+#undef CASE
+#undef R
+}
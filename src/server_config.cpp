@@ -0,0 +1,71 @@
+#include "server_config.hpp"
+#include "logger.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static constexpr int MAX_TIMEOUT_SEC = 24 * 60 * 60;
+
+// A timeout flag's value. Below 1 the timer wheel would expire every
+// connection at once, or poll() would wait forever; above a day the
+// milliseconds overflow an int and poll() waits forever too. Either is a
+// usage error.
+static int timeout_seconds(const std::string& key, const std::string& val) {
+    size_t used = 0;
+    int secs = 0;
+    try { secs = std::stoi(val, &used); } catch (...) {}
+    if (!val.empty() && used == val.size() && secs >= 1 && secs <= MAX_TIMEOUT_SEC) return secs;
+
+    std::cerr << "usage: " << key << "=<seconds> needs a whole number from 1 to " << MAX_TIMEOUT_SEC
+              << " (got \"" << val << "\")" << std::endl;
+    std::exit(2);
+}
+
+ServerConfig ServerConfig::fromArgs(int argc, char** argv) {
+    ServerConfig cfg;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string val = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        try {
+            if (key == "--port")                   cfg.port = std::stoi(val);
+            else if (key == "--backend") {
+                if (val == "epoll")      cfg.backend = IoBackend::EPOLL;
+                else if (val == "uring") cfg.backend = IoBackend::URING;
+                else throw std::invalid_argument(val);
+            }
+            else if (key == "--backlog")            cfg.listen_backlog = std::stoi(val);
+            else if (key == "--shards")             cfg.shards = std::stoul(val);
+            else if (key == "--workers")            cfg.worker_threads = std::stoul(val);
+            else if (key == "--keepalive-timeout")  cfg.keepalive_timeout_sec = timeout_seconds(key, val);
+            else if (key == "--keepalive-max")      cfg.keepalive_max_requests = std::stoul(val);
+            else if (key == "--header-timeout")     cfg.header_timeout_sec = timeout_seconds(key, val);
+            else if (key == "--body-timeout")       cfg.body_timeout_sec = timeout_seconds(key, val);
+            else if (key == "--write-timeout")      cfg.write_timeout_sec = timeout_seconds(key, val);
+            else if (key == "--script-engine") {
+                if (val == "vm")       cfg.script_engine = ScriptEngine::VM;
+                else if (val == "ast") cfg.script_engine = ScriptEngine::AST;
+                else throw std::invalid_argument(val);
+            }
+            else if (key == "--log-level") {
+                if (val == "debug")      cfg.log_level = LogLevel::DEBUG;
+                else if (val == "info")  cfg.log_level = LogLevel::INFO;
+                else if (val == "warn")  cfg.log_level = LogLevel::WARN;
+                else if (val == "error") cfg.log_level = LogLevel::ERR;
+                else throw std::invalid_argument(val);
+            }
+            else if (key == "--profile-scripts")    cfg.profile_scripts = true;
+            else if (key == "--fragment-cache-mb")  cfg.fragment_cache_mb = std::stoul(val);
+            else LOG(LogLevel::WARN, "Ignoring unknown option: " + arg);
+        } catch (...) {
+            LOG(LogLevel::WARN, "Bad value for option: " + arg);
+        }
+    }
+
+    if (cfg.shards == 0) cfg.shards = 1;
+    return cfg;
+}
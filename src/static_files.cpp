@@ -0,0 +1,72 @@
+#include "static_files.hpp"
+#include "router.hpp"
+#include "logger.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::list<StaticFileCache::Entry> StaticFileCache::lru;
+std::unordered_map<std::string, std::list<StaticFileCache::Entry>::iterator> StaticFileCache::index;
+std::mutex StaticFileCache::mtx;
+
+StaticFile::~StaticFile() {
+    if (fd >= 0) close(fd);
+}
+
+std::shared_ptr<const StaticFile> StaticFileCache::load(const std::string& path) {
+    int fd = ::open(("service" + path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+
+    auto file = std::make_shared<StaticFile>();
+    file->fd = fd;
+    file->size = st.st_size;
+    file->inode = st.st_ino;
+    file->mtime = st.st_mtime;
+    file->mimeType = Router::getMimeType(path);
+    return file;
+}
+
+std::shared_ptr<const StaticFile> StaticFileCache::open(const std::string& path) {
+    // Basic security: don't allow ".." to escape the service folder
+    if (path.find("..") != std::string::npos) return nullptr;
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mtx);
+
+    auto it = index.find(path);
+    if (it != index.end()) {
+        Entry& entry = *it->second;
+        lru.splice(lru.begin(), lru, it->second);
+
+        if (now - entry.checked < std::chrono::seconds(1)) return entry.file;
+
+        // Still the same file on disk?
+        struct stat st;
+        if (stat(("service" + path).c_str(), &st) == 0 && st.st_ino == entry.file->inode &&
+            st.st_size == entry.file->size && st.st_mtime == entry.file->mtime) {
+            entry.checked = now;
+            return entry.file;
+        }
+
+        lru.erase(it->second);
+        index.erase(it);
+    }
+
+    auto file = load(path);
+    if (!file) return nullptr;
+
+    lru.push_front({path, file, now});
+    index[path] = lru.begin();
+    if (lru.size() > CAPACITY) {
+        index.erase(lru.back().path);
+        lru.pop_back();
+    }
+    LOG(LogLevel::DEBUG, "Static cache: opened " + path + " (" + std::to_string(file->size) + " bytes)");
+    return file;
+}
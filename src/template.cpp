@@ -2,51 +2,70 @@
 #include "template.hpp"
 #include "logger.hpp"
 #include "value.hpp"
+#include "file_cache.hpp"
+#include "template_aot.hpp"
+#include <unordered_map>
 #include <sstream>
 #include <algorithm>
+#include <charconv>
 
-std::vector<std::unique_ptr<Node>> TemplateParser::parse(std::string stopTag) {
+// Parsed (or compiled-in) templates by path, rebuilt when the file
+// changes on disk
+static FileCache<CompiledTemplate> templates([](const std::string& path, const std::string& source) {
+    auto tpl = std::make_shared<CompiledTemplate>();
+    tpl->compiled = TemplateAot::find(path, source);
+    if (tpl->compiled) {
+        LOG(LogLevel::DEBUG, "Template: " + path + " is compiled in");
+    } else {
+        TemplateParser parser(source);
+        tpl->nodes = parser.parse();
+    }
+    return std::shared_ptr<const CompiledTemplate>(std::move(tpl));
+});
+
+std::vector<std::unique_ptr<Node>> TemplateParser::parse(std::string_view stopTag) {
     std::vector<std::unique_ptr<Node>> nodes;
     while (pos < input.length()) {
-        size_t start = input.find("{", pos);
-        if (start == std::string::npos) {
-            nodes.push_back(std::make_unique<TextNode>(input.substr(pos)));
+        size_t start = input.find('{', pos);
+        if (start == std::string_view::npos) {
+            nodes.push_back(std::make_unique<TextNode>(std::string(input.substr(pos))));
             break;
         }
 
-        nodes.push_back(std::make_unique<TextNode>(input.substr(pos, start - pos)));
+        if (start > pos) nodes.push_back(std::make_unique<TextNode>(std::string(input.substr(pos, start - pos))));
         pos = start;
 
-        if (input.substr(pos, 2) == "{{") {
+        if (input.compare(pos, 2, "{{") == 0) {
             size_t end = input.find("}}", pos);
-            std::string varName = trim(input.substr(pos + 2, end - pos - 2));
-            nodes.push_back(std::make_unique<VarNode>(varName));
+            if (end == std::string_view::npos) {
+                // No closing braces: the rest is text
+                nodes.push_back(std::make_unique<TextNode>(std::string(input.substr(pos))));
+                break;
+            }
+            std::string_view varName = trim(input.substr(pos + 2, end - pos - 2));
+            nodes.push_back(std::make_unique<VarNode>(std::string(varName)));
             pos = end + 2;
 
-        } else if (input.substr(pos, 2) == "{%") {
+        } else if (input.compare(pos, 2, "{%") == 0) {
             size_t end = input.find("%}", pos);
-            if (end == std::string::npos) {
+            if (end == std::string_view::npos) {
                 // Safety: no closing tag, just treat as text or throw
                 nodes.push_back(std::make_unique<TextNode>("{%"));
                 pos += 2;
                 continue;
             }
 
-            std::string content = trim(input.substr(pos + 2, end - pos - 2));
+            std::string_view content = trim(input.substr(pos + 2, end - pos - 2));
 
-            // CRITICAL FIX START: 
-            // Advance the position PAST the closing '%}' BEFORE recursion
-            pos = end + 2; 
+            // Advance past the closing '%}' before recursing, so the
+            // nested parse() starts after this tag
+            pos = end + 2;
 
             if (!stopTag.empty() && content == stopTag) {
                 return nodes; // We found our 'endfor' or 'endif'
             }
 
-            // Now call parseTag. Since pos is advanced, 
-            // the recursive call to parse() will start looking AFTER this tag.
             nodes.push_back(parseTag(content));
-            
-            // REMOVE 'pos = end + 2;' from here if it's currently after parseTag
         } else {
             nodes.push_back(std::make_unique<TextNode>("{"));
             pos++;
@@ -54,103 +73,247 @@ std::vector<std::unique_ptr<Node>> TemplateParser::parse(std::string stopTag) {
     }
     // A simple safety check in parse()
     if (nodes.size() > 1000) { 
-        Logger::log(LogLevel::ERR, "Template too complex or recursive loop detected!");
+        LOG(LogLevel::ERR, "Template too complex or recursive loop detected!");
         return nodes; 
     } 
     return nodes;
 }
 
-std::unique_ptr<Node> TemplateParser::parseTag(const std::string& content) {
-    if (content.find("if ") == 0) {
+// "a 'b c' d" -> a, 'b c', d (quotes kept)
+static std::vector<std::string_view> split_words(std::string_view s) {
+    std::vector<std::string_view> words;
+    size_t i = 0;
+    while (i < s.size()) {
+        if (s[i] == ' ' || s[i] == '\t') { i++; continue; }
+        size_t start = i;
+        if (s[i] == '"' || s[i] == '\'') {
+            size_t close = s.find(s[i], i + 1);
+            i = close == std::string_view::npos ? s.size() : close + 1;
+        } else {
+            while (i < s.size() && s[i] != ' ' && s[i] != '\t') i++;
+        }
+        words.push_back(s.substr(start, i - start));
+    }
+    return words;
+}
+
+std::unique_ptr<Node> TemplateParser::parseTag(std::string_view content) {
+    if (content.substr(0, 3) == "if ") {
         auto node = std::make_unique<IfNode>();
-        node->conditionVar = trim(content.substr(3));
+        node->conditionVar = std::string(trim(content.substr(3)));
         node->children = parse("endif");
         return node;
     } 
-    else if (content.find("for ") == 0) {
+    else if (content.substr(0, 4) == "for ") {
         auto node = std::make_unique<ForNode>();
-        std::string loopDef = trim(content.substr(4));
+        std::string_view loopDef = trim(content.substr(4));
         size_t inPos = loopDef.find(" in ");
-        if (inPos != std::string::npos) {
-            node->itemVar = trim(loopDef.substr(0, inPos));
-            node->listVar = trim(loopDef.substr(inPos + 4));
+        if (inPos != std::string_view::npos) {
+            node->itemVar = std::string(trim(loopDef.substr(0, inPos)));
+            node->listVar = std::string(trim(loopDef.substr(inPos + 4)));
         }
         node->children = parse("endfor");
         return node;
     }
+    else if (content.substr(0, 6) == "cache ") {
+        auto node = std::make_unique<CacheNode>();
+        std::vector<std::string_view> words = split_words(content.substr(6));
+        if (!words.empty()) {
+            auto [end, ec] = std::from_chars(words.back().data(), words.back().data() + words.back().size(), node->ttl);
+            if (ec != std::errc() || end != words.back().data() + words.back().size()) node->ttl = 0;
+            words.pop_back();
+        }
+        if (words.empty() || node->ttl <= 0) {
+            LOG(LogLevel::ERR, "Template: {% " + std::string(content) + " %} needs a key and a TTL in seconds; not caching it");
+        } else if (node->ttl > FragmentCache::MAX_TTL) {
+            LOG(LogLevel::WARN, "Template: {% " + std::string(content) + " %} caches for longer than " +
+                std::to_string(FragmentCache::MAX_TTL) + "s; using that");
+            node->ttl = FragmentCache::MAX_TTL;
+        }
+        for (std::string_view word : words) {
+            if (word.size() >= 2 && (word.front() == '"' || word.front() == '\'') && word.back() == word.front()) {
+                node->keyParts.push_back(std::make_unique<TextNode>(std::string(word.substr(1, word.size() - 2))));
+            } else {
+                node->keyParts.push_back(std::make_unique<VarNode>(std::string(word)));
+            }
+        }
+        node->children = parse("endcache");
+        return node;
+    }
     return std::make_unique<TextNode>(""); // Unknown tags
 }
 
-// This matches the Template::render call in your router
-std::string Template::render(std::string html, const RenderContext& ctx) {
-    TemplateParser parser(html);
-    auto nodes = parser.parse();
-    std::string result = "";
-    for (auto& node : nodes) {
-        result += node->render(ctx);
+std::shared_ptr<const CompiledTemplate> Template::load(const std::string& path) {
+    // Basic security: don't allow ".." to escape the service folder
+    if (path.find("..") != std::string::npos) return nullptr;
+    return templates.get("service/" + path);
+}
+
+std::string Template::render(const CompiledTemplate& tpl, const RenderContext& ctx) {
+    RenderSink page;
+    size_t hint = tpl.sizeHint.load(std::memory_order_relaxed);
+    page.buffer.reserve(hint);
+    render(tpl, ctx, page);
+
+    // Room for this page plus some growth next time; one outsized page
+    // only raises the hint for a while
+    size_t size = page.buffer.size();
+    tpl.sizeHint.store(std::max(size + size / 8, hint - hint / 8), std::memory_order_relaxed);
+    return std::move(page.buffer);
+}
+
+void Template::render(const CompiledTemplate& tpl, const RenderContext& ctx, RenderSink& out) {
+    if (tpl.compiled) {
+        tpl.compiled(ctx, out);
+        return;
+    }
+    for (auto& node : tpl.nodes) {
+        node->render(ctx, out);
     }
-    return result;
 }
 
-std::string TextNode::render(const RenderContext& ctx) {
-    return text;
+// Strings go in without a copy; other values as their text
+static void write_value(const Value& v, RenderSink& out) {
+    if (v.isString()) out.write(v.stringView());
+    else out.write(v.asString());
+}
+
+void TextNode::render(const RenderContext&, RenderSink& out) const {
+    out.write(text);
 }
 
-std::string VarNode::render(const RenderContext& ctx) {
-    // Split "saint.name" into ["saint", "name"]
+VarNode::VarNode(std::string n) : name(std::move(n)) {
     size_t dot = name.find('.');
     if (dot != std::string::npos) {
-        std::string objName = name.substr(0, dot);
-        std::string property = name.substr(dot + 1);
-
-        if (ctx.vars.count(objName)) {
-            const Value& obj = ctx.vars.at(objName);
-            if (obj.isObject()) {
-                const auto& fields = obj.asObject();
-                return fields.count(property) ? fields.at(property).asString() : "";
-            }
+        dotted = true;
+        object = name.substr(0, dot);
+        property = name.substr(dot + 1);
+    }
+}
+
+const Value* RenderContext::find(std::string_view name) const {
+    for (const RenderContext* frame = this; frame; frame = frame->parent) {
+        if (frame->item) {
+            if (*frame->itemName == name) return frame->item;
+            continue;
+        }
+        if (!frame->names) continue;
+        for (size_t i = 0; i < frame->names->size(); i++) {
+            const auto& value = (*frame->values)[i];
+            if (value && (*frame->names)[i] == name) return &*value;
         }
     }
+    return nullptr;
+}
 
-    return ctx.vars.count(name) ? ctx.vars.at(name).asString() : "";
+void VarNode::render(const RenderContext& ctx, RenderSink& out) const {
+    if (dotted) TemplateAot::writeField(ctx, name, object, property, out);
+    else TemplateAot::writeVar(ctx, name, out);
 }
 
+void IfNode::render(const RenderContext& ctx, RenderSink& out) const {
+    // Render the children only if the condition variable is set and truthy
+    if (!TemplateAot::truthy(ctx, conditionVar)) return;
+    for (auto& child : children) {
+        child->render(ctx, out);
+    }
+}
 
+void ForNode::render(const RenderContext& ctx, RenderSink& out) const {
+    const std::vector<Value>* items = TemplateAot::list(ctx, listVar);
+    if (!items) return;
 
-std::string IfNode::render(const RenderContext& ctx) {
-    // 1. Look up the condition variable in the context
-    if (ctx.vars.count(conditionVar)) {
-        const Value& val = ctx.vars.at(conditionVar);
+    for (const auto& item : *items) {
+        // 'item' is a Value (could be an Object, String, etc.), seen by
+        // the children under itemVar
+        RenderContext loopCtx(ctx, itemVar, item);
 
-        // 2. Use our new helper to decide if we should render the children
-        if (val.isTruthy()) {
-            std::string result = "";
-            for (auto& child : children) {
-                result += child->render(ctx);
-            }
-            return result;
+        for (auto& child : children) {
+            child->render(loopCtx, out);
         }
     }
-    return "";
 }
 
-std::string ForNode::render(const RenderContext& ctx) {
-    std::string result = "";
-    
-    if (ctx.vars.count(listVar)) {
-        const Value& listVal = ctx.vars.at(listVar);
-        
-        if (listVal.isList()) {
-            for (const auto& item : listVal.asList()) {
-                RenderContext loopCtx = ctx;
-                // 'item' is a Value (could be an Object, String, etc.)
-                loopCtx.vars[itemVar] = item; 
+void CacheNode::render(const RenderContext& ctx, RenderSink& out) const {
+    if (ttl <= 0) {
+        for (auto& child : children) child->render(ctx, out);
+        return;
+    }
+
+    RenderSink key, part;
+    for (auto& keyPart : keyParts) {
+        part.buffer.clear();
+        keyPart->render(ctx, part);
+        TemplateAot::keyPart(key, part.buffer);
+    }
 
-                for (auto& child : children) {
-                    result += child->render(loopCtx);
-                }
-            }
+    TemplateAot::cached(key.buffer, ttl, out, [&](RenderSink& fragment) {
+        for (auto& child : children) {
+            child->render(ctx, fragment);
         }
+    });
+}
+
+// --- Shared with the compiled templates (template_aot.hpp) ---
+
+// Compiled templates by path; filled before main() and only read after
+static std::unordered_map<std::string, std::pair<uint64_t, TemplateAot::RenderFn>>& aot_registry() {
+    static std::unordered_map<std::string, std::pair<uint64_t, TemplateAot::RenderFn>> registry;
+    return registry;
+}
+
+bool TemplateAot::add(const char* path, uint64_t sourceHash, RenderFn render) {
+    aot_registry()[path] = {sourceHash, render};
+    return true;
+}
+
+TemplateAot::RenderFn TemplateAot::find(const std::string& path, std::string_view source) {
+    auto it = aot_registry().find(path);
+    if (it == aot_registry().end()) return nullptr;
+    if (it->second.first != hash(source)) {
+        LOG(LogLevel::WARN, "Template: " + path + " changed since it was compiled; interpreting it");
+        return nullptr;
     }
-    return result;
-}
\ No newline at end of file
+    return it->second.second;
+}
+
+uint64_t TemplateAot::hash(std::string_view source) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : source) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void TemplateAot::writeVar(const RenderContext& ctx, std::string_view name, RenderSink& out) {
+    if (const Value* value = ctx.find(name)) write_value(*value, out);
+}
+
+void TemplateAot::writeField(const RenderContext& ctx, std::string_view name, std::string_view object,
+                             const std::string& property, RenderSink& out) {
+    const Value* obj = ctx.find(object);
+    if (!obj || !obj->isObject()) {
+        writeVar(ctx, name, out);
+        return;
+    }
+    const auto& fields = obj->asObject();
+    auto field = fields.find(property);
+    if (field != fields.end()) write_value(field->second, out);
+}
+
+bool TemplateAot::truthy(const RenderContext& ctx, std::string_view name) {
+    const Value* value = ctx.find(name);
+    return value && value->isTruthy();
+}
+
+const std::vector<Value>* TemplateAot::list(const RenderContext& ctx, std::string_view name) {
+    const Value* value = ctx.find(name);
+    return value && value->isList() ? &value->asList() : nullptr;
+}
+
+void TemplateAot::keyPart(RenderSink& key, std::string_view part) {
+    key.write(std::to_string(part.size()));
+    key.write(":");
+    key.write(part);
+}
@@ -0,0 +1,222 @@
+// Build step: turns templates into C++ render functions that register
+// themselves with TemplateAot (see CMakeLists.txt).
+//
+//   template_compiler <out.cpp> service/a.html service/b.html ...
+//
+// Templates are registered under the paths given, so run it from the
+// directory the server runs in. A template with a construct this doesn't
+// know is left out, and the server interprets it as before.
+#include "template.hpp"
+#include "template_aot.hpp"
+#include "logger.hpp"
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+class TemplateCodegen {
+public:
+    // Appends `static void <fn>(ctx, out)` for these nodes; false if one
+    // of them can't be compiled
+    bool function(const std::string& fn, const std::vector<std::unique_ptr<Node>>& nodes) {
+        body.clear();
+        depth = 1;
+        nextId = 0;
+        usesContext = false;
+        if (!emitAll(nodes, "ctx", "out")) return false;
+        // A page of plain text never looks at ctx; leave it unnamed then
+        functions += "static void " + fn + "(const RenderContext&" + (usesContext ? " ctx" : "") +
+                     ", RenderSink& out) {\n" + body + "}\n\n";
+        return true;
+    }
+
+    std::string file(const std::string& registrations) const {
+        return "// Generated by template_compiler. Do not edit.\n"
+               "#include \"template_aot.hpp\"\n\n" +
+               names + (names.empty() ? "" : "\n") + functions + registrations;
+    }
+
+    // A C++ literal for `text`, split after each newline. Octal escapes,
+    // since a hex one would swallow following hex digits.
+    static std::string literal(std::string_view text) {
+        std::string out = "\"";
+        for (size_t i = 0; i < text.size(); i++) {
+            unsigned char c = text[i];
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+                if (i + 1 < text.size()) out += "\"\n        \"";
+            } else if (c < 0x20 || c >= 0x7f) {
+                char esc[5];
+                snprintf(esc, sizeof(esc), "\\%03o", c);
+                out += esc;
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+private:
+    std::string names;      // file-scope std::strings the code refers to
+    std::string functions;
+    std::string body;
+    int depth = 1;
+    int nextId = 0;
+    bool usesContext = false;
+    std::map<std::string, std::string> nameIds;
+
+    void line(const std::string& code) {
+        body.append(depth * 4, ' ');
+        body += code;
+        body += '\n';
+    }
+
+    // A std::string with this text that lives as long as the program
+    std::string name(const std::string& text) {
+        auto it = nameIds.find(text);
+        if (it != nameIds.end()) return it->second;
+        std::string id = "name_" + std::to_string(nameIds.size());
+        names += "static const std::string " + id + "(" + literal(text) + ");\n";
+        nameIds[text] = id;
+        return id;
+    }
+
+    std::string fresh(const char* prefix) { return prefix + std::to_string(++nextId); }
+
+    bool emitAll(const std::vector<std::unique_ptr<Node>>& nodes, const std::string& ctx, const std::string& out) {
+        for (const auto& node : nodes) {
+            if (!emit(*node, ctx, out)) return false;
+        }
+        return true;
+    }
+
+    void emitVar(const VarNode& var, const std::string& ctx, const std::string& out) {
+        usesContext = true;
+        if (var.dotted) {
+            line("TemplateAot::writeField(" + ctx + ", " + literal(var.name) + ", " + literal(var.object) + ", " +
+                 name(var.property) + ", " + out + ");");
+        } else {
+            line("TemplateAot::writeVar(" + ctx + ", " + literal(var.name) + ", " + out + ");");
+        }
+    }
+
+    bool emit(const Node& node, const std::string& ctx, const std::string& out) {
+        if (auto* text = dynamic_cast<const TextNode*>(&node)) {
+            if (!text->text.empty()) {
+                line(out + ".write(std::string_view(" + literal(text->text) + ", " +
+                     std::to_string(text->text.size()) + "));");
+            }
+            return true;
+        }
+        if (auto* var = dynamic_cast<const VarNode*>(&node)) {
+            emitVar(*var, ctx, out);
+            return true;
+        }
+        if (auto* cond = dynamic_cast<const IfNode*>(&node)) {
+            usesContext = true;
+            line("if (TemplateAot::truthy(" + ctx + ", " + literal(cond->conditionVar) + ")) {");
+            depth++;
+            bool ok = emitAll(cond->children, ctx, out);
+            depth--;
+            line("}");
+            return ok;
+        }
+        if (auto* loop = dynamic_cast<const ForNode*>(&node)) {
+            usesContext = true;
+            std::string items = fresh("items"), item = fresh("item"), inner = fresh("ctx");
+            line("if (const std::vector<Value>* " + items + " = TemplateAot::list(" + ctx + ", " +
+                 literal(loop->listVar) + ")) {");
+            depth++;
+            line("for (const Value& " + item + " : *" + items + ") {");
+            depth++;
+            line("RenderContext " + inner + "(" + ctx + ", " + name(loop->itemVar) + ", " + item + ");");
+            bool ok = emitAll(loop->children, inner, out);
+            depth--;
+            line("}");
+            depth--;
+            line("}");
+            return ok;
+        }
+        if (auto* cache = dynamic_cast<const CacheNode*>(&node)) {
+            if (cache->ttl <= 0) return emitAll(cache->children, ctx, out);
+
+            std::string key = fresh("key"), part = fresh("part"), fragment = fresh("fragment");
+            line("{");
+            depth++;
+            line("RenderSink " + key + ", " + part + ";");
+            for (auto& keyPart : cache->keyParts) {
+                line(part + ".buffer.clear();");
+                if (!emit(*keyPart, ctx, part)) return false;
+                line("TemplateAot::keyPart(" + key + ", " + part + ".buffer);");
+            }
+            line("TemplateAot::cached(" + key + ".buffer, " + std::to_string(cache->ttl) + ", " + out +
+                 ", [&](RenderSink& " + fragment + ") {");
+            depth++;
+            bool ok = emitAll(cache->children, ctx, fragment);
+            depth--;
+            line("});");
+            depth--;
+            line("}");
+            return ok;
+        }
+        return false;
+    }
+};
+
+static bool read_file(const std::string& path, std::string& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+    std::stringstream b;
+    b << f.rdbuf();
+    out = b.str();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <out.cpp> [template.html...]\n";
+        return 2;
+    }
+
+    TemplateCodegen gen;
+    std::string registrations;
+    int compiled = 0;
+
+    for (int i = 2; i < argc; i++) {
+        std::string path = argv[i];
+        std::string source;
+        if (!read_file(path, source)) {
+            std::cerr << "template_compiler: can't read " << path << "\n";
+            return 1;
+        }
+
+        TemplateParser parser(source);
+        auto nodes = parser.parse();
+        std::string fn = "render_" + std::to_string(i - 2);
+        if (!gen.function(fn, nodes)) {
+            std::cerr << "template_compiler: " << path << " has a tag it can't compile; it will be interpreted\n";
+            continue;
+        }
+
+        char hash[32];
+        snprintf(hash, sizeof(hash), "0x%016llxull", static_cast<unsigned long long>(TemplateAot::hash(source)));
+        registrations += "    TemplateAot::add(" + TemplateCodegen::literal(path) + ", " + hash + ", " + fn + ") &&\n";
+        compiled++;
+    }
+
+    std::string code = gen.file(registrations.empty() ? "" :
+        "static const bool registered =\n" + registrations.substr(0, registrations.size() - 4) + ";\n");
+
+    std::ofstream out(argv[1], std::ios::binary);
+    out << code;
+    if (!out) {
+        std::cerr << "template_compiler: can't write " << argv[1] << "\n";
+        return 1;
+    }
+    std::cout << "template_compiler: " << compiled << " of " << argc - 2 << " templates compiled\n";
+    Logger::flush();
+    return 0;
+}
@@ -0,0 +1,441 @@
+#include "uring_loop.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <linux/time_types.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static constexpr unsigned RING_ENTRIES = 256;
+static constexpr unsigned BUF_COUNT = 128;          // power of two
+static constexpr size_t BUF_SIZE = 16 * 1024;
+static constexpr unsigned short BUF_GROUP = 0;
+static constexpr int OP_BITS = 3;
+
+static int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return int(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                          const void* arg, size_t argsz) {
+    return int(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+static int io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return int(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+static std::runtime_error uring_error(const std::string& what) {
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+UringLoop::UringLoop(int lfd, WorkerPool& p, const ServerConfig& c) : EventLoop(lfd, p, c) {
+    try {
+        setup();
+    } catch (...) {
+        release();
+        throw;
+    }
+    LOG(LogLevel::INFO, "Event loop: io_uring backend");
+}
+
+UringLoop::~UringLoop() {
+    for (auto& [id, conn] : closing) close(conn->fd);
+    release();
+}
+
+void UringLoop::setup() {
+    // 1. The ring itself. Multishot accept/recv mean lots of CQEs per SQE,
+    //    so the completion side gets extra room.
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = RING_ENTRIES * 4;
+    ring_fd = io_uring_setup(RING_ENTRIES, &params);
+    if (ring_fd < 0) throw uring_error("io_uring_setup");
+
+    unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & needed) != needed) throw std::runtime_error("kernel too old");
+
+    // 2. Multishot recv came with 6.0, the same release as SEND_ZC, which
+    //    unlike the recv flag shows up in the opcode probe.
+    std::vector<char> probe_mem(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(probe_mem.data());
+    if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, 256) < 0 ||
+        probe->last_op < IORING_OP_SEND_ZC ||
+        !(probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED)) {
+        throw std::runtime_error("multishot recv not supported");
+    }
+
+    // 3. Map the SQ/CQ rings (one mapping) and the SQE array
+    ring_map_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                             params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring_map = mmap(nullptr, ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd, IORING_OFF_SQ_RING);
+    if (ring_map == MAP_FAILED) { ring_map = nullptr; throw uring_error("mmap(rings)"); }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqe_map = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, IORING_OFF_SQES);
+    if (sqe_map == MAP_FAILED) throw uring_error("mmap(sqes)");
+    sqes = static_cast<io_uring_sqe*>(sqe_map);
+
+    char* base = static_cast<char*>(ring_map);
+    sq_head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    sq_mask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sq_entries = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_entries);
+    cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+    // 4. Provided buffer ring for receives, shared by every connection
+    buf_ring_size = BUF_COUNT * sizeof(io_uring_buf);
+    void* ring_mem = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring_mem == MAP_FAILED) throw uring_error("mmap(buffer ring)");
+    buf_ring = static_cast<io_uring_buf_ring*>(ring_mem);
+
+    void* buf_mem = mmap(nullptr, BUF_COUNT * BUF_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf_mem == MAP_FAILED) throw uring_error("mmap(buffers)");
+    buffers = static_cast<char*>(buf_mem);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+    reg.ring_entries = BUF_COUNT;
+    reg.bgid = BUF_GROUP;
+    if (io_uring_register(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        throw uring_error("register buffer ring");
+    for (unsigned bid = 0; bid < BUF_COUNT; bid++) returnBuffer(bid);
+}
+
+void UringLoop::release() {
+    if (buffers) munmap(buffers, BUF_COUNT * BUF_SIZE);
+    if (buf_ring) munmap(buf_ring, buf_ring_size);
+    if (sqes) munmap(sqes, sqes_size);
+    if (ring_map) munmap(ring_map, ring_map_size);
+    if (ring_fd >= 0) close(ring_fd);
+    buffers = nullptr;
+    buf_ring = nullptr;
+    sqes = nullptr;
+    ring_map = nullptr;
+    ring_fd = -1;
+}
+
+void UringLoop::run() {
+    armAccept();
+    armWake();
+
+    while (true) {
+        // Submit whatever the last round queued and sleep until a completion
+        // or the next wheel tick, all in one syscall.
+        submit(timers.msUntilNextTick());
+        expireTimers();
+
+        // Handlers may queue more SQEs; they go out with the next submit()
+        unsigned head = *cq_head;
+        while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = cqes[head & cq_mask];
+            __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+            onCompletion(cqe);
+        }
+    }
+}
+
+io_uring_sqe* UringLoop::nextSqe(uint64_t id, Op op) {
+    reserve(1);
+    unsigned tail = *sq_tail + pending;
+    unsigned index = tail & sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (id << OP_BITS) | op;
+    sq_array[index] = index;
+    pending++;
+    return sqe;
+}
+
+void UringLoop::reserve(unsigned count) {
+    // A linked chain has to go out in one submission, so make room for all
+    // of it up front rather than flushing half way through.
+    unsigned used = *sq_tail + pending - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (used + count > sq_entries) submit(0);
+}
+
+void UringLoop::submit(int wait_ms) {
+    __atomic_store_n(sq_tail, *sq_tail + pending, __ATOMIC_RELEASE);
+
+    unsigned flags = 0, min_complete = 0;
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    if (wait_ms != 0) {
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        min_complete = 1;
+        arg.sigmask_sz = _NSIG / 8;
+        if (wait_ms > 0) {
+            ts.tv_sec = wait_ms / 1000;
+            ts.tv_nsec = (wait_ms % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+    }
+
+    int ret = io_uring_enter(ring_fd, pending, min_complete, flags,
+                             flags ? &arg : nullptr, flags ? sizeof(arg) : 0);
+    if (ret >= 0) {
+        pending -= std::min<unsigned>(pending, ret);
+        return;
+    }
+    // ETIME/EINTR: nothing to reap yet. EBUSY: the CQ is backed up, reap first.
+    if (errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+        LOG(LogLevel::ERR, "io_uring_enter failed: " + std::string(strerror(errno)));
+}
+
+void UringLoop::onCompletion(const io_uring_cqe& cqe) {
+    uint64_t id = cqe.user_data >> OP_BITS;
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+
+    switch (Op(cqe.user_data & ((1 << OP_BITS) - 1))) {
+        case ACCEPT:
+            if (cqe.res >= 0) {
+                armRecv(addConnection(cqe.res));
+            } else {
+                LOG(LogLevel::WARN, "accept failed: " + std::string(strerror(-cqe.res)));
+            }
+            if (!more) armAccept();
+            return;
+        case WAKE:
+            drainCompletions();
+            if (!more) armWake();
+            return;
+        case RECV:
+            onRecv(id, cqe.res, cqe.flags);
+            return;
+        case SEND:
+            onSend(id, cqe.res);
+            return;
+        case POLL: {
+            // Room in the socket again for a sendfile() body
+            Connection* conn = findConnection(id);
+            if (conn && conn->state == ConnState::WRITING) startWrite(*conn);
+            return;
+        }
+        case IGNORE:
+            return;
+    }
+}
+
+void UringLoop::armAccept() {
+    io_uring_sqe* sqe = nextSqe(0, ACCEPT);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+}
+
+void UringLoop::armWake() {
+    io_uring_sqe* sqe = nextSqe(0, WAKE);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wake_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+}
+
+void UringLoop::armRecv(Connection& conn) {
+    io_uring_sqe* sqe = nextSqe(conn.id, RECV);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+}
+
+void UringLoop::queueClose(int fd) {
+    // The multishot recv holds a reference to the socket, so close() alone
+    // wouldn't hang up. Cancel it first; the hard link runs the close even
+    // when there was nothing left to cancel.
+    reserve(2);
+    io_uring_sqe* sqe = nextSqe(0, IGNORE);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->flags = IOSQE_IO_HARDLINK | IOSQE_CQE_SKIP_SUCCESS;
+
+    sqe = nextSqe(0, IGNORE);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
+
+void UringLoop::returnBuffer(unsigned bid) {
+    // Index the ring as a plain array: in C++ the header's flexible-array
+    // wrapper shifts `bufs` by the size of an empty struct.
+    io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(buf_ring)[buf_tail & (BUF_COUNT - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(buffers + bid * BUF_SIZE);
+    buf.len = BUF_SIZE;
+    buf.bid = bid;
+    buf_tail++;
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+}
+
+void UringLoop::onRecv(uint64_t id, int res, unsigned flags) {
+    Connection* conn = findConnection(id);
+
+    // 1. Copy the bytes out and hand the buffer straight back to the ring.
+    //    While a request is being worked on, its views point into conn.in,
+    //    so anything arriving meanwhile waits in the backlog.
+    if (flags & IORING_CQE_F_BUFFER) {
+        unsigned bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        if (conn && res > 0) {
+            std::string& dest = conn->state == ConnState::READING ? conn->in : conn->backlog;
+            dest.append(buffers + bid * BUF_SIZE, res);
+        }
+        returnBuffer(bid);
+    }
+    if (!conn) return;  // closed meanwhile
+
+    // 2. Keep the recv armed. ENOBUFS just means we were slow returning
+    //    buffers; they're back by now.
+    if (res < 0 && res != -ENOBUFS) {
+        closeConnection(*conn);
+        return;
+    }
+    if (res == 0) {
+        conn->peer_closed = true;
+    } else if (!(flags & IORING_CQE_F_MORE)) {
+        armRecv(*conn);
+    }
+
+    // 3. Same as the epoll path from here on
+    if (conn->state != ConnState::READING) {
+        if (res > 0) conn->read_pending = true;
+        // Pipelining this far ahead of us isn't a client we want to buffer for
+        if (conn->backlog.size() > MAX_REQUEST_SIZE) closeConnection(*conn);
+        return;
+    }
+    if (conn->in.size() > MAX_REQUEST_SIZE) {
+        onRequestStatus(*conn, IoStatus::TOO_LARGE);
+        return;
+    }
+    onRequestStatus(*conn, parse_buffered_request(*conn));
+}
+
+IoStatus UringLoop::readPending(Connection& conn) {
+    conn.read_pending = false;
+    conn.in.append(conn.backlog);
+    conn.backlog.clear();
+    if (conn.in.size() > MAX_REQUEST_SIZE) return IoStatus::TOO_LARGE;
+    return parse_buffered_request(conn);
+}
+
+void UringLoop::startWrite(Connection& conn) {
+    // No sendfile opcode: write static bodies directly and let the ring
+    // tell us when the socket has room again.
+    if (conn.file) {
+        switch (write_response(conn)) {
+            case IoStatus::AGAIN: {
+                armTimer(conn, Timeout::WRITE);
+                io_uring_sqe* sqe = nextSqe(conn.id, POLL);
+                sqe->opcode = IORING_OP_POLL_ADD;
+                sqe->fd = conn.fd;
+                sqe->poll32_events = POLLOUT;
+                return;
+            }
+            case IoStatus::DONE:
+                finishResponse(conn);
+                return;
+            default:
+                closeConnection(conn);
+                return;
+        }
+    }
+
+    // Head and body go out as linked sends (plus the close if we're done
+    // with the socket). MSG_WAITALL makes the kernel finish each send or
+    // fail it, so a short write can never let the chain run on to the
+    // close. The kernel doesn't report progress, so the write deadline
+    // covers the whole response here.
+    bool has_body = !conn.body.empty();
+    bool close_after = !conn.keep_alive;
+    reserve(2 + (close_after ? 2 : 0));
+    armTimer(conn, Timeout::WRITE);
+    conn.send_inflight = true;
+
+    io_uring_sqe* sqe = nextSqe(conn.id, has_body ? IGNORE : SEND);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(conn.head.data());
+    sqe->len = conn.head.size();
+    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL | (has_body ? MSG_MORE : 0);
+    if (has_body || close_after) sqe->flags |= IOSQE_IO_LINK;
+
+    if (has_body) {
+        // Only the last send reports success; a failed head still posts
+        // (and cancels the body, which then reports the failure)
+        sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
+        sqe = nextSqe(conn.id, SEND);
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(conn.body.data());
+        sqe->len = conn.body.size();
+        sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        if (close_after) sqe->flags |= IOSQE_IO_LINK;
+    }
+    if (close_after) queueClose(conn.fd);
+}
+
+void UringLoop::onSend(uint64_t id, int res) {
+    Connection* conn = findConnection(id);
+    std::unique_ptr<Connection> parked;
+    if (!conn) {
+        auto it = closing.find(id);
+        if (it == closing.end()) return;
+        parked = std::move(it->second);
+        closing.erase(it);
+        conn = parked.get();
+    }
+
+    conn->send_inflight = false;
+    size_t expected = conn->body.empty() ? conn->head.size() : conn->body.size();
+    bool ok = res >= 0 && size_t(res) == expected;
+    // A send that fully succeeded ran on into its linked cancel + close
+    conn->close_linked = ok && !conn->keep_alive;
+
+    if (parked) {
+        closeSocket(std::move(parked));
+        return;
+    }
+    if (!ok) {
+        closeConnection(*conn);
+        return;
+    }
+    conn->sent = conn->head.size() + conn->body.size();
+    finishResponse(*conn);
+}
+
+void UringLoop::abandonSocket(Connection& conn) {
+    // Ends the multishot recv too; the fd is closed once the worker is done
+    shutdown(conn.fd, SHUT_RDWR);
+}
+
+void UringLoop::closeSocket(std::unique_ptr<Connection> conn) {
+    if (conn->send_inflight) {
+        // The kernel is still sending from head/body. Cancel that and wait
+        // for its completion before the fd and buffers can go.
+        io_uring_sqe* sqe = nextSqe(0, IGNORE);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = conn->fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+        closing[conn->id] = std::move(conn);
+        return;
+    }
+    if (!conn->close_linked) queueClose(conn->fd);
+    recycle(std::move(conn));
+}
@@ -0,0 +1,68 @@
+#include "value.hpp"
+
+Value::Value(std::string v) {
+    if (v.size() <= INLINE_CHARS) {
+        setType(Type::STRING);
+        std::memcpy(bytes, v.data(), v.size());
+        bytes[LEN_BYTE] = static_cast<unsigned char>(v.size());
+        return;
+    }
+    auto* node = new StringData;
+    node->text = std::move(v);
+    setShared(Type::STRING, node);
+}
+
+Value::Value(std::vector<Value> v) {
+    auto* node = new ListData;
+    node->items = std::move(v);
+    setShared(Type::LIST, node);
+}
+
+Value::Value(std::map<std::string, Value> v) {
+    auto* node = new ObjectData;
+    node->fields = std::move(v);
+    setShared(Type::OBJECT, node);
+}
+
+void Value::destroy() {
+    switch (type()) {
+        case Type::STRING: delete static_cast<StringData*>(node()); break;
+        case Type::LIST:   delete static_cast<ListData*>(node()); break;
+        case Type::OBJECT: delete static_cast<ObjectData*>(node()); break;
+        default: break;
+    }
+}
+
+std::string Value::asString() const {
+    switch (type()) {
+        case Type::STRING: return std::string(stringView());
+        case Type::INT:    return std::to_string(load<int>());
+        case Type::BOOL:   return load<bool>() ? "true" : "false";
+        case Type::LIST:   return "[List]";
+        case Type::OBJECT: return "[Object]";
+    }
+    return "";
+}
+
+bool Value::operator==(const Value& other) const {
+    if (type() != other.type()) return false;
+    switch (type()) {
+        case Type::BOOL:   return load<bool>() == other.load<bool>();
+        case Type::INT:    return load<int>() == other.load<int>();
+        case Type::STRING: return stringView() == other.stringView();
+        case Type::LIST:   return node() == other.node() || asList() == other.asList();
+        case Type::OBJECT: return node() == other.node() || asObject() == other.asObject();
+    }
+    return false;
+}
+
+bool Value::isTruthy() const {
+    switch (type()) {
+        case Type::BOOL:   return load<bool>();
+        case Type::INT:    return load<int>() != 0;
+        case Type::STRING: return !stringView().empty();
+        case Type::LIST:   return !asList().empty();
+        case Type::OBJECT: return !asObject().empty();
+    }
+    return false;
+}
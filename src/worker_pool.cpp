@@ -0,0 +1,65 @@
+#include "worker_pool.hpp"
+#include "event_loop.hpp"
+#include "logger.hpp"
+#include "response_stream.hpp"
+#include <pthread.h>
+#include <sched.h>
+
+void pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        LOG(LogLevel::WARN, "Could not pin thread to CPU " + std::to_string(cpu));
+    }
+}
+
+WorkerPool::WorkerPool(size_t threads, size_t queue_capacity, int cpu) : queue(queue_capacity) {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this, cpu);
+    }
+    LOG(LogLevel::INFO, "Worker pool: " + std::to_string(threads) + " threads, queue of " +
+                std::to_string(queue_capacity));
+}
+
+WorkerPool::~WorkerPool() {
+    queue.close();
+    for (auto& t : workers) t.join();
+}
+
+void WorkerPool::workerLoop(int cpu) {
+    if (cpu >= 0) pin_current_thread(cpu);
+
+    RequestJob job;
+    while (queue.pop(job)) {
+        // Only used if the route streams; otherwise it never touches the socket
+        ResponseStream stream(job.fd, job.keep_alive, job.origin->config());
+
+        HttpResponse res;
+        bool threw = false;
+        try {
+            res = Router::handleRequest(job.req, &stream);
+        } catch (const std::exception& e) {
+            LOG(LogLevel::ERR, "Worker: unhandled error: " + std::string(e.what()));
+            res = HttpResponse::html("500 Internal Server Error", "500 Internal Server Error");
+            threw = true;
+        }
+        res.stream = nullptr;
+
+        if (stream.started()) {
+            // Already on the wire; the loop only has to move on. An error,
+            // redirect or second page after the headers went out can't
+            // reach the client, so the page it got is cut short.
+            if (threw || res.status != stream.status() || !res.body.empty()) {
+                LOG(LogLevel::WARN, "Worker: streamed response ended with " + res.status + ", cutting it off");
+                stream.abort();
+            }
+            stream.finish();
+            job.origin->complete(job.fd, job.conn_id, std::move(res),
+                                 stream.failed() ? Delivery::STREAM_FAILED : Delivery::STREAMED);
+        } else {
+            job.origin->complete(job.fd, job.conn_id, std::move(res));
+        }
+    }
+}
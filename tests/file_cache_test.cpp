@@ -0,0 +1,62 @@
+// FileCache checks: a file whose loader throws is built once per change,
+// not once per get(), and is rebuilt when it changes on disk.
+#include "file_cache.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+static int failures = 0;
+
+static void check(const char* name, bool ok) {
+    if (ok) return;
+    std::cerr << "FAIL " << name << "\n";
+    failures++;
+}
+
+static void write_file(const std::string& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+}
+
+int main() {
+    const std::string path = "file_cache_test.tmp";
+    int builds = 0;
+    FileCache<std::string> cache([&](const std::string&, const std::string& source) {
+        builds++;
+        if (source == "broken") throw std::runtime_error("can't build");
+        return std::make_shared<const std::string>(source);
+    });
+
+    auto throws = [&] {
+        try {
+            cache.get(path);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+
+    write_file(path, "broken");
+    check("first get of a broken file throws", throws());
+    check("second get throws the cached error", throws());
+    check("a broken file is built once", builds == 1);
+
+    // Changes are noticed on the next stat, at most a second later
+    write_file(path, "fixed now");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    auto value = cache.get(path);
+    check("the fixed file is rebuilt", value && *value == "fixed now" && builds == 2);
+    check("then served from the cache", cache.get(path) == value && builds == 2);
+
+    check("a missing file is nullptr", cache.get("file_cache_test.missing") == nullptr);
+
+    std::remove(path.c_str());
+    Logger::flush();
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "file_cache_test: all checks passed\n";
+    return 0;
+}
@@ -0,0 +1,100 @@
+// FragmentCache checks: entries expire after their TTL, each shard stays
+// under its share of the budget by dropping its least recently used
+// entries, entries bigger than a shard are refused, and the counters
+// behind describe() add up.
+#include "fragment_cache.hpp"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(const char* name, bool ok) {
+    if (ok) return;
+    std::cerr << "FAIL " << name << "\n";
+    failures++;
+}
+
+static size_t shard_of(const std::string& key) { return std::hash<std::string>{}(key) % FragmentCache::SHARDS; }
+
+// `count` keys that share a shard with each other and with none of `others`
+static std::vector<std::string> keys_in_one_shard(size_t count, const std::vector<std::string>& others) {
+    size_t shard = 0;
+    while (std::any_of(others.begin(), others.end(), [&](const std::string& k) { return shard_of(k) == shard; })) {
+        shard++;
+    }
+    std::vector<std::string> keys;
+    for (int i = 0; keys.size() < count; i++) {
+        std::string key = "lru-" + std::to_string(i);
+        if (shard_of(key) == shard) keys.push_back(key);
+    }
+    return keys;
+}
+
+int main() {
+    using std::chrono::seconds;
+    const size_t SHARD_BYTES = 1000;
+    FragmentCache::setCapacity(SHARD_BYTES * FragmentCache::SHARDS);
+
+    // Counters
+    FragmentCache::Stats before = FragmentCache::stats();
+    check("unknown key misses", FragmentCache::get("stats") == nullptr);
+    FragmentCache::put("stats", "<p>hi</p>", seconds(60));
+    auto html = FragmentCache::get("stats");
+    check("stored fragment is returned", html && *html == "<p>hi</p>");
+    FragmentCache::Stats after = FragmentCache::stats();
+    check("one miss counted", after.misses == before.misses + 1);
+    check("one hit counted", after.hits == before.hits + 1);
+    check("entry and its bytes counted",
+          after.entries == before.entries + 1 && after.bytes == before.bytes + 5 + 9);
+
+    // TTLs
+    FragmentCache::put("no-ttl", "x", seconds(0));
+    check("a zero TTL isn't stored", FragmentCache::get("no-ttl") == nullptr);
+    FragmentCache::put("forever", "x", seconds::max());
+    check("a huge TTL is capped, not overflowed into the past", FragmentCache::get("forever") != nullptr);
+
+    FragmentCache::put("short", "x", seconds(1));
+    check("fresh entry hits", FragmentCache::get("short") != nullptr);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    before = FragmentCache::stats();
+    check("expired entry misses", FragmentCache::get("short") == nullptr);
+    after = FragmentCache::stats();
+    check("expiry counted as a miss and dropped", after.misses == before.misses + 1 &&
+                                                      after.entries == before.entries - 1);
+
+    // Oversized: key + fragment over one shard's budget
+    FragmentCache::put("big", std::string(SHARD_BYTES, 'x'), seconds(60));
+    check("fragment over the shard budget is refused", FragmentCache::get("big") == nullptr);
+
+    // Eviction: three 400-byte entries in a 1000-byte shard
+    std::vector<std::string> keys = keys_in_one_shard(3, {"stats", "forever"});
+    std::string fragment(400 - keys[0].size(), 'x');
+    before = FragmentCache::stats();
+    FragmentCache::put(keys[0], fragment, seconds(60));
+    FragmentCache::put(keys[1], fragment, seconds(60));
+    FragmentCache::get(keys[0]); // now keys[1] is the least recently used
+    FragmentCache::put(keys[2], fragment, seconds(60));
+    after = FragmentCache::stats();
+    check("one eviction counted", after.evictions == before.evictions + 1);
+    check("least recently used entry evicted", FragmentCache::get(keys[1]) == nullptr);
+    check("recently used entry kept", FragmentCache::get(keys[0]) != nullptr);
+    check("newest entry kept", FragmentCache::get(keys[2]) != nullptr);
+
+    // Storing a key again replaces it without counting an eviction
+    before = FragmentCache::stats();
+    FragmentCache::put(keys[2], "y", seconds(60));
+    after = FragmentCache::stats();
+    html = FragmentCache::get(keys[2]);
+    check("put replaces an existing key", html && *html == "y");
+    check("replacing isn't an eviction", after.evictions == before.evictions && after.entries == before.entries);
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "fragment_cache_test: all checks passed\n";
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Request framing checks for HttpRequestParser. Every case here is one
+// where getting the body length wrong would let the bytes after it run
+// as a second, smuggled request on a keep-alive connection.
+#include "http_parser.hpp"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static int failures = 0;
+
+// Parses `raw` in one go and checks the result and, on error, the status
+static void expect(const char* name, std::string_view raw, HttpRequestParser::Result want,
+                   const char* status = nullptr) {
+    HttpRequestParser parser;
+    HttpRequestParser::Result got = parser.parse(raw);
+    bool ok = got == want;
+    if (ok && want == HttpRequestParser::Result::ERROR && status) {
+        ok = parser.errorStatus() && std::strcmp(parser.errorStatus(), status) == 0;
+    }
+    if (!ok) {
+        std::cerr << "FAIL " << name << ": got result " << static_cast<int>(got) << " ("
+                  << (parser.errorStatus() ? parser.errorStatus() : "no error") << ")\n";
+        failures++;
+    }
+}
+
+int main() {
+    using R = HttpRequestParser::Result;
+
+    expect("plain GET", "GET / HTTP/1.1\r\nHost: x\r\n\r\n", R::COMPLETE);
+    expect("POST with a length", "POST /f HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc", R::COMPLETE);
+
+    // A chunked body must not be read as empty with its contents left over
+    expect("chunked body",
+           "POST /f HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+           "1e\r\nGET /users/smuggled HTTP/1.1\r\n\r\n0\r\n\r\n",
+           R::ERROR, "501 Not Implemented");
+    expect("transfer-encoding in any case", "POST /f HTTP/1.1\r\ntransfer-encoding: identity\r\n\r\n",
+           R::ERROR, "501 Not Implemented");
+    expect("transfer-encoding with a length",
+           "POST /f HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n",
+           R::ERROR, "501 Not Implemented");
+
+    // Two lengths: whichever one we picked, a proxy may have picked the other
+    expect("conflicting lengths", "POST /f HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 0\r\n\r\nhello",
+           R::ERROR, "400 Bad Request");
+    expect("repeated length", "POST /f HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\nhello",
+           R::ERROR, "400 Bad Request");
+
+    // A length that isn't a plain number
+    expect("non-numeric length", "POST /f HTTP/1.1\r\nContent-Length: abc\r\n\r\n", R::ERROR, "400 Bad Request");
+    expect("trailing junk in length", "POST /f HTTP/1.1\r\nContent-Length: 5x\r\n\r\nhello",
+           R::ERROR, "400 Bad Request");
+    expect("empty length", "POST /f HTTP/1.1\r\nContent-Length:\r\n\r\n", R::ERROR, "400 Bad Request");
+    expect("signed length", "POST /f HTTP/1.1\r\nContent-Length: -1\r\n\r\n", R::ERROR, "400 Bad Request");
+    expect("huge length", "POST /f HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n",
+           R::ERROR, "413 Payload Too Large");
+
+    // Lines that aren't headers used to be skipped without being counted
+    expect("line without a colon", "GET / HTTP/1.1\r\nHost: x\r\njunk\r\n\r\n", R::ERROR, "400 Bad Request");
+    expect("empty header name", "GET / HTTP/1.1\r\n: x\r\n\r\n", R::ERROR, "400 Bad Request");
+
+    // The header block as a whole is capped, not just an unfinished line
+    std::string big = "GET / HTTP/1.1\r\n";
+    for (int i = 0; i < 40; i++) big += "X-Pad-" + std::to_string(i) + ": " + std::string(2000, 'a') + "\r\n";
+    expect("header block over the limit", big + "\r\n", R::ERROR, "431 Request Header Fields Too Large");
+    expect("header block over the limit, unfinished", big, R::ERROR, "431 Request Header Fields Too Large");
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "http_parser_test: all checks passed\n";
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Differential test for the script engines. Every service/*.script under
+// each directory given runs, for a GET and a form POST, three ways:
+//  - on the bytecode VM, as the server runs it;
+//  - on the AST interpreter, over the same optimized tree;
+//  - on the AST interpreter, over the tree as parsed, before
+//    ScriptOptimizer. The other two share the optimizer, so this is what
+//    catches a bug in it.
+// All three must produce the same response: status, headers, cookies and
+// body.
+//
+//   script_engine_test <dir>...
+//
+// Scripts and templates are loaded relative to the working directory, so
+// the test changes into each directory in turn.
+#include "script_executor.hpp"
+#include "script_resolver.hpp"
+#include "logic_engine.hpp"
+#include "http_parser.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+static const char* REQUESTS[] = {
+    "GET /t HTTP/1.1\r\nHost: test\r\nCookie: user=bob; sid=abc\r\n\r\n",
+    "POST /t HTTP/1.1\r\nHost: test\r\nCookie: user=bob\r\nContent-Length: 22\r\n\r\nuser=alice&pass=hunter",
+};
+
+static std::vector<std::string> scripts_in(const std::string& dir) {
+    std::vector<std::string> found;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* e = readdir(d)) {
+            std::string name = e->d_name;
+            if (name.size() > 7 && name.compare(name.size() - 7, 7, ".script") == 0) {
+                found.push_back(dir + "/" + name);
+            }
+        }
+        closedir(d);
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+static std::string describe(const HttpResponse& res) {
+    std::string out = res.status + "\n";
+    for (const auto& [name, value] : res.headers) out += name + ": " + value + "\n";
+    for (const auto& cookie : res.set_cookies) out += "Set-Cookie: " + cookie + "\n";
+    return out + "\n" + res.body;
+}
+
+enum class Run { VM, AST, UNOPTIMIZED };
+
+// ScriptExecutor::execute on the tree straight from the parser
+static void execute_unoptimized(const std::string& script, const HttpRequest& req, HttpResponse& res,
+                                const RouteParams& params) {
+    try {
+        std::ifstream file(script, std::ios::binary);
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string text = source.str();
+
+        ScriptLexer lexer(text);
+        ScriptParser parser(lexer.tokenize());
+        std::unique_ptr<ASTNode> ast = parser.parseProgram();
+        std::vector<std::string> locals = ScriptResolver::resolve(*ast);
+
+        ScriptContext ctx(req, res);
+        ctx.locals.resize(locals.size());
+        ctx.localNames = &locals;
+        if (req.method == "POST") ctx.form = Parser::parseForm(std::string(req.body));
+        for (size_t i = 0; i < params.count; i++) {
+            ctx.params[std::string(params.items[i].name)] = std::string(params.items[i].value);
+        }
+        ast->reduce(ctx);
+    } catch (const std::exception& e) {
+        res.status = "500 Internal Server Error";
+        res.body = "Script Error: " + std::string(e.what());
+    }
+}
+
+static HttpResponse run(Run how, const std::string& script, const std::string& raw) {
+    HttpRequestParser parser;
+    HttpRequest req;
+    parser.parse(raw);
+    parser.fill(req, raw.data());
+
+    RouteParams params;
+    params.items[params.count++] = {"id", "7"};
+
+    HttpResponse res;
+    if (how == Run::UNOPTIMIZED) {
+        execute_unoptimized(script, req, res, params);
+    } else {
+        ScriptExecutor::setEngine(how == Run::VM ? ScriptEngine::VM : ScriptEngine::AST);
+        ScriptExecutor::execute(script, req, res, params);
+    }
+    return res;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <dir>...\n";
+        return 2;
+    }
+    Logger::setLevel(LogLevel::ERR);
+
+    int checked = 0, failures = 0;
+    for (int i = 1; i < argc; i++) {
+        if (chdir(argv[i]) != 0) {
+            std::cerr << "FAIL can't enter " << argv[i] << "\n";
+            failures++;
+            continue;
+        }
+        for (const std::string& script : scripts_in("service")) {
+            for (const std::string raw : REQUESTS) {
+                std::string vm = describe(run(Run::VM, script, raw));
+                std::string ast = describe(run(Run::AST, script, raw));
+                std::string unoptimized = describe(run(Run::UNOPTIMIZED, script, raw));
+                checked++;
+                if (vm == ast && ast == unoptimized) continue;
+
+                failures++;
+                std::cerr << "FAIL " << argv[i] << "/" << script << " (" << raw.substr(0, raw.find(' '))
+                          << ")\n--- vm\n" << vm << "\n--- ast\n" << ast << "\n--- unoptimized ast\n"
+                          << unoptimized << "\n";
+            }
+        }
+    }
+
+    Logger::flush();
+    if (failures) {
+        std::cerr << failures << " of " << checked << " runs differ\n";
+        return 1;
+    }
+    std::cout << "script_engine_test: " << checked << " runs identical on all three\n";
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Compiled templates against the interpreter. template_compiler builds
+// every service/*.html under the directory given into this binary; each
+// one is then rendered both ways, with the nodes TemplateParser makes and
+// with the generated function, over a few sets of variables. The output
+// must be byte-for-byte the same:
+//  - with the fragment cache off, so every {% cache %} body renders;
+//  - with it on, where the compiled render must also find every fragment
+//    the interpreted one just stored, i.e. build the same keys.
+//
+//   template_aot_test <dir>
+#include "template.hpp"
+#include "template_aot.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void check(const std::string& name, bool ok) {
+    if (ok) return;
+    std::cerr << "FAIL " << name << "\n";
+    failures++;
+}
+
+static std::vector<std::string> templates_in(const std::string& dir) {
+    std::vector<std::string> found;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* e = readdir(d)) {
+            std::string name = e->d_name;
+            if (name.size() > 5 && name.compare(name.size() - 5, 5, ".html") == 0) {
+                found.push_back(dir + "/" + name);
+            }
+        }
+        closedir(d);
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+// The root frame a script's locals would make
+struct Variables {
+    const char* label;
+    std::vector<std::string> names;
+    std::vector<std::optional<Value>> values;
+
+    explicit Variables(const char* label) : label(label) {}
+    Variables& set(const std::string& name, Value value) {
+        names.push_back(name);
+        values.emplace_back(std::move(value));
+        return *this;
+    }
+};
+
+static Value object(std::map<std::string, Value> fields) { return Value(std::move(fields)); }
+static Value list(std::vector<Value> items) { return Value(std::move(items)); }
+static Value str(const char* text) { return Value(std::string(text)); }
+
+static std::vector<Variables> variable_sets() {
+    std::vector<Variables> sets;
+
+    Variables full("full");
+    full.set("a", str("text")).set("b", 42).set("c", true).set("d", false).set("e", str(""))
+        .set("f", 0).set("g", Value(std::string(300, 'g'))).set("h", -7)
+        .set("i", list({1, 2})).set("j", object({{"x", 1}})).set("k", str("<b>&amp;</b>"))
+        .set("l", list({str("x"), str("y"), 3})).set("m", str("m")).set("o", object({{"x", str("ox")}}))
+        .set("who", str("World")).set("title", str("Saints")).set("n", 3).set("greeting", str("hi"))
+        .set("flag", true).set("user", object({{"lang", str("en")}}))
+        .set("saints", list({object({{"name", str("Anne")}, {"age", 80}}),
+                             object({{"name", str("Bob")}}),
+                             object({{"name", str("a:b")}, {"age", str("old")}})}))
+        .set("grid", list({list({1, str("two"), false, str("")}), list({}), list({true, 0})}));
+    sets.push_back(full);
+
+    // Everything unbound
+    sets.push_back(Variables("empty"));
+
+    // Wrong types everywhere: loops over non-lists, fields of non-objects
+    Variables odd("odd");
+    odd.set("title", list({1})).set("saints", str("saints")).set("flag", str("")).set("user", str("en"))
+        .set("grid", list({1, str("row")})).set("o", 5).set("l", object({{"x", 1}})).set("who", false)
+        .set("n", object({}));
+    sets.push_back(odd);
+
+    return sets;
+}
+
+static std::string render_nodes(const std::vector<std::unique_ptr<Node>>& nodes, const RenderContext& ctx) {
+    RenderSink out;
+    for (auto& node : nodes) node->render(ctx, out);
+    return out.buffer;
+}
+
+static std::string render_compiled(TemplateAot::RenderFn fn, const RenderContext& ctx) {
+    RenderSink out;
+    fn(ctx, out);
+    return out.buffer;
+}
+
+struct Case {
+    std::string path;
+    std::vector<std::unique_ptr<Node>> nodes;
+    TemplateAot::RenderFn compiled;
+};
+
+// Renders `c` both ways and reports any difference; returns the page
+static std::string compare(const Case& c, const Variables& vars, bool cacheOn) {
+    RenderContext ctx(vars.names, vars.values);
+    std::string interpreted = render_nodes(c.nodes, ctx);
+    uint64_t misses = FragmentCache::stats().misses;
+    std::string compiled = render_compiled(c.compiled, ctx);
+
+    std::string name = c.path + " (" + vars.label + ", cache " + (cacheOn ? "on" : "off") + ")";
+    if (compiled != interpreted) {
+        std::cerr << "FAIL " << name << "\n--- interpreted\n" << interpreted << "\n--- compiled\n" << compiled << "\n";
+        failures++;
+    }
+    if (cacheOn) check(name + ": a fragment the interpreter stored was missed", FragmentCache::stats().misses == misses);
+    return interpreted;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <dir>\n";
+        return 2;
+    }
+    Logger::setLevel(LogLevel::ERR);
+    if (chdir(argv[1]) != 0) {
+        std::cerr << "FAIL can't enter " << argv[1] << "\n";
+        return 1;
+    }
+
+    std::vector<Case> cases;
+    for (const std::string& path : templates_in("service")) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream source;
+        source << file.rdbuf();
+
+        Case c{path, TemplateParser(source.str()).parse(), TemplateAot::find(path, source.str())};
+        check(path + " was compiled into the test", c.compiled != nullptr);
+        if (c.compiled) cases.push_back(std::move(c));
+    }
+    std::vector<Variables> sets = variable_sets();
+
+    // Nothing fits, so nothing is stored and every cache body renders
+    FragmentCache::setCapacity(0);
+    for (const Case& c : cases) {
+        for (const Variables& vars : sets) compare(c, vars, false);
+    }
+
+    // The interpreter fills the cache, the compiled function reads it back
+    FragmentCache::setCapacity(16 << 20);
+    for (const Case& c : cases) {
+        for (const Variables& vars : sets) {
+            std::string page = compare(c, vars, true);
+            // ("a:b", "c") and ("a", "b:c") are different keys
+            if (c.path == "service/cached.html") {
+                check(c.path + ": cache keys collide", page.find("one|two") != std::string::npos);
+            }
+        }
+    }
+
+    Logger::flush();
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "template_aot_test: " << cases.size() << " templates render the same compiled\n";
+    return 0;
+}